@@ -38,6 +38,11 @@ extern const struct PatchStruct patches[] PROGMEM;
 #define COLLECT_TREASURE_POINTS 5
 #define KILL_MONSTER_POINTS 25
 
+#if (PROJECTILES > 0)
+#define PROJECTILE_DX (WORLD_MAXDX * 2)         // thrown at twice the speed a player can run
+#define PROJECTILE_DY (-(WORLD_JUMP / WORLD_FPS) / 2) // with half the upward speed of a jump
+#endif // PROJECTILES
+
 /*
  * BCD_zero
  *
@@ -242,6 +247,29 @@ static bool BCD_decrement(uint8_t* const num, const uint8_t digits)
   return false;
 }
 
+/*
+ * BCD_toBinary
+ *
+ * Converts a BCD number to binary
+ *
+ * num [in]
+ *   The BCD number
+ *
+ * digits [in]
+ *   The number of digits in the BCD number, num
+ *
+ * Returns:
+ *   The value of the BCD number.
+ */
+__attribute__(( optimize("Os") ))
+static uint32_t BCD_toBinary(const uint8_t* const num, uint8_t digits)
+{
+  uint32_t value = 0;
+  while (digits--)
+    value = value * 10 + num[digits];
+  return value;
+}
+
 /*
  * BCD_display
  *
@@ -262,16 +290,26 @@ static bool BCD_decrement(uint8_t* const num, const uint8_t digits)
 __attribute__(( always_inline ))
 static inline void BCD_display(const uint8_t x, const uint8_t y, const uint8_t* const num, uint8_t digits)
 {
-  uint16_t offset = y * SCREEN_TILES_H + x;
-  while (digits--)
-    vram[offset++] = num[digits] + FIRST_DIGIT_TILE + RAM_TILES_COUNT;
+  uint16_t offset = vramOffset(screenToWorldX(x), y);
+  while (digits--) {
+    vram[offset] = num[digits] + FIRST_DIGIT_TILE + RAM_TILES_COUNT;
+    offset = vramRight(offset);
+  }
 }
 
-__attribute__(( optimize("Os") ))
-static bool PgmBitArray_readBit(const uint8_t* const array, const uint16_t index)
-{
-  return (bool)(pgm_read_byte(array + (index >> 3)) & (1 << (index & 7)));
-}
+// Set to 1 to load levels from a level pack on the SD card, when one is present (see LEVEL_PACK in default/Makefile)
+#ifndef LEVEL_PACK
+#define LEVEL_PACK 0
+#endif // LEVEL_PACK
+
+#if (LEVEL_PACK == 1)
+// The current level is always copied into levelCache, so level data is read from RAM
+#define levelReadByte(p) (*(p))
+#define levelRead(dst, src, n) memcpy((dst), (src), (n))
+#else // LEVEL_PACK
+#define levelReadByte(p) pgm_read_byte(p)
+#define levelRead(dst, src, n) memcpy_P((dst), (src), (n))
+#endif // LEVEL_PACK
 
 __attribute__(( optimize("Os") ))
 static uint8_t PgmPacked5Bit_read(const uint8_t* const packed, const uint16_t position) // having 'const uint8_t* const packed' really helps optimization here!
@@ -280,38 +318,475 @@ static uint8_t PgmPacked5Bit_read(const uint8_t* const packed, const uint16_t po
   const uint16_t i = position * 5 / 8; // 5 bits packed into 8
   switch (position % 8) {
   case 0: // bits: 4 3 2 1 0 x x x
-    value = ((pgm_read_byte(packed + i)) >> 3) & 0x1F;
+    value = ((levelReadByte(packed + i)) >> 3) & 0x1F;
     break;
   case 1: // bits: x x x x x 4 3 2
           // bits: 1 0 x x x x x x
-    value = (((pgm_read_byte(packed + i)) << 2) | (((pgm_read_byte(packed + i + 1)) >> 6) & 0x03)) & 0x1F;
+    value = (((levelReadByte(packed + i)) << 2) | (((levelReadByte(packed + i + 1)) >> 6) & 0x03)) & 0x1F;
     break;
   case 2: // bits: x x 4 3 2 1 0 x
-    value = ((pgm_read_byte(packed + i)) >> 1) & 0x1F;
+    value = ((levelReadByte(packed + i)) >> 1) & 0x1F;
     break;
   case 3: // bits: x x x x x x x 4
           // bits: 3 2 1 0 x x x x
-    value = (((pgm_read_byte(packed + i)) << 4) | (((pgm_read_byte(packed + i + 1)) >> 4) & 0x0F)) & 0x1F;
+    value = (((levelReadByte(packed + i)) << 4) | (((levelReadByte(packed + i + 1)) >> 4) & 0x0F)) & 0x1F;
     break;
   case 4: // bits: x x x x 4 3 2 1
           // bits: 0 x x x x x x x
-    value = (((pgm_read_byte(packed + i)) << 1) | (((pgm_read_byte(packed + i + 1)) >> 7) & 0x01)) & 0x1F;
+    value = (((levelReadByte(packed + i)) << 1) | (((levelReadByte(packed + i + 1)) >> 7) & 0x01)) & 0x1F;
     break;
   case 5: // bits: x 4 3 2 1 0 x x
-    value = ((pgm_read_byte(packed + i)) >> 2) & 0x1F;
+    value = ((levelReadByte(packed + i)) >> 2) & 0x1F;
     break;
   case 6: // bits: x x x x x x 4 3
           // bits: 2 1 0 x x x x x
-    value = (((pgm_read_byte(packed + i)) << 3) | (((pgm_read_byte(packed + i + 1)) >> 5) & 0x07)) & 0x1F;
+    value = (((levelReadByte(packed + i)) << 3) | (((levelReadByte(packed + i + 1)) >> 5) & 0x07)) & 0x1F;
     break;
   default: // case 7
            // bits: x x x 4 3 2 1 0
-    value = (pgm_read_byte(packed + i)) & 0x1F;
+    value = (levelReadByte(packed + i)) & 0x1F;
     break;
   }
   return value;
 }
 
+// Set to 0 to leave out the CPU opponent, which plays player 2 in a P1 VS P2 game started while holding B (see doTitleScreen)
+#ifndef CPU_OPPONENT
+#if (PLAYERS > 1)
+#define CPU_OPPONENT 1
+#else
+#define CPU_OPPONENT 0 // there is no player 2 to play
+#endif
+#endif // CPU_OPPONENT
+
+#if (CPU_OPPONENT == 1)
+#if (PLAYERS < 2)
+#error CPU_OPPONENT requires PLAYERS >= 2
+#endif // (PLAYERS < 2)
+
+// Most cycles for the CPU opponent to spend each frame, which a PROFILE build measures as cpu_input
+#ifndef CPU_BUDGET_CYCLES
+#define CPU_BUDGET_CYCLES 4800
+#endif // CPU_BUDGET_CYCLES
+
+#define CPU_NODES 24          // size of the search pool, which also holds the route once the search is done
+#define CPU_JUMP_TILES 4      // how many tiles a jump rises
+#define CPU_JUMP_REACH 4      // how many tiles across a jump carries
+#ifndef CPU_FALL_TILES
+#define CPU_FALL_TILES 8      // how far a fall can be planned, which bounds the rows that each landing reads
+#endif // CPU_FALL_TILES
+#define CPU_STOMP_TILES 6     // player 1 becomes the target when it is this close, in tiles across plus tiles up or down
+#define CPU_PATIENCE_FRAMES 120 // frames to get to the next node of the route, before the target is given up on
+#define CPU_SKIPS 4           // treasures that can be given up on at once
+#define CPU_SCAN_CYCLES 400   // most that looking for treasure on one row, and the rest of a frame that doesn't search, costs
+#define CPU_NODE_CYCLES 4400  // most that picking and expanding one node costs, with every landing CPU_FALL_TILES down
+#define CPU_NODES_PER_FRAME ((CPU_BUDGET_CYCLES - CPU_SCAN_CYCLES) / CPU_NODE_CYCLES)
+#define CPU_NONE 0xFF
+
+// The columns that the CPU opponent plans over, which for WIDE_LEVELS are the ones on the screen
+#if (WIDE_LEVELS == 1)
+#define CPU_LEFT cameraX
+#else // WIDE_LEVELS
+#define CPU_LEFT 0
+#endif // WIDE_LEVELS
+#define CPU_RIGHT (CPU_LEFT + SCREEN_TILES_H - 1)
+
+// How the route gets from a node's parent to the node
+enum CPU_MOVE {
+  CPU_START = 0, // the tile the search started from
+  CPU_WALK = 1,  // a step left or right, which may fall off of a ledge
+  CPU_JUMP = 2,  // a jump left or right, up onto a ledge or across a gap
+  CPU_CLIMB = 3, // a step up or down a ladder
+  CPU_DROP = 4,  // down through a one-way tile
+};
+#define CPU_CLOSED 0x80 // set in move once a node has been expanded
+
+struct CPU_NODE;
+typedef struct CPU_NODE CPU_NODE;
+
+struct CPU_NODE {
+  uint8_t tx;     // tile the entity stands on, or hangs from a ladder at
+  uint8_t ty;
+  uint8_t parent; // index of the node it is reached from
+  uint8_t move;   // CPU_MOVE, plus CPU_CLOSED
+};
+
+struct CPU;
+typedef struct CPU CPU;
+
+struct CPU {
+  CPU_NODE node[CPU_NODES]; // node 0 is where the route starts
+  uint8_t count;            // nodes in use
+  uint8_t best;             // the node nearest the goal, where the route ends
+  bool searching;           // the route is not done yet
+  uint8_t goalX;            // tile the route leads to
+  uint8_t goalY;
+  uint8_t way;              // node being headed for, or CPU_NONE
+  uint8_t treasureX;        // nearest treasure found by the last full scan of the screen, or CPU_NONE
+  uint8_t treasureY;
+  uint8_t scanY;            // next row to scan for treasure
+  uint8_t scanX;            // nearest treasure of the scan so far, or CPU_NONE
+  uint8_t scanBestY;
+  uint8_t scanDistance;
+  uint8_t patience;         // frames left to get to the node being headed for
+  uint8_t skip[CPU_SKIPS][2]; // treasures that there was no way to, which are left alone
+  uint8_t skipNext;         // the oldest of them, which the next one replaces
+};
+
+static CPU cpu;
+
+#define Cpu_distance(x1, y1, x2, y2) ((uint8_t)(((x1) > (x2) ? (x1) - (x2) : (x2) - (x1)) + ((y1) > (y2) ? (y1) - (y2) : (y2) - (y1))))
+#define Cpu_tile(tx, ty) vramTile(vramOffset((tx), (ty)))
+
+// Forgets the route, the targets, and the scan, when the CPU opponent spawns
+__attribute__(( optimize("Os") ))
+static void Cpu_begin(void)
+{
+  memset(&cpu, 0, sizeof(cpu));
+  memset(cpu.skip, CPU_NONE, sizeof(cpu.skip));
+  cpu.goalX = cpu.way = cpu.treasureX = cpu.scanX = cpu.scanDistance = CPU_NONE;
+}
+
+// True if an entity can be in the tile at (tx, ty) without being blocked or burnt
+static bool Cpu_passable(const uint8_t tx, const uint8_t ty)
+{
+  if ((uint8_t)(tx - CPU_LEFT) >= SCREEN_TILES_H || ty >= SCREEN_TILES_V) // also catches a column left of CPU_LEFT, which wraps around
+    return false;
+  const uint8_t t = Cpu_tile(tx, ty);
+  return !isSolid(t) && !isFire(t);
+}
+
+// The row that an entity falling from the passable tile at (tx, ty) lands on, or CPU_NONE if it falls into fire, out of the level, or further than CPU_FALL_TILES
+static uint8_t Cpu_land(const uint8_t tx, uint8_t ty)
+{
+  const uint8_t last = (ty + CPU_FALL_TILES < SCREEN_TILES_V - 1) ? ty + CPU_FALL_TILES : SCREEN_TILES_V - 1;
+  for (; ty < last; ++ty) {
+    const uint8_t below = Cpu_tile(tx, ty + 1);
+    if (isSolid(below) || isOneWay(below))
+      return ty;
+    if (isFire(below))
+      return CPU_NONE;
+  }
+  return CPU_NONE;
+}
+
+// Adds the node at (tx, ty) to the search, unless it is already in it, or there is no room left
+static void Cpu_add(const uint8_t tx, const uint8_t ty, const uint8_t parent, const uint8_t move)
+{
+  if (ty == CPU_NONE || cpu.count == CPU_NODES)
+    return;
+  for (uint8_t i = 0; i < cpu.count; ++i)
+    if (cpu.node[i].tx == tx && cpu.node[i].ty == ty)
+      return;
+  CPU_NODE* const n = &cpu.node[cpu.count];
+  n->tx = tx;
+  n->ty = ty;
+  n->parent = parent;
+  n->move = move;
+  const CPU_NODE* const b = &cpu.node[cpu.best];
+  if (Cpu_distance(tx, ty, cpu.goalX, cpu.goalY) < Cpu_distance(b->tx, b->ty, cpu.goalX, cpu.goalY))
+    cpu.best = cpu.count;
+  ++cpu.count;
+}
+
+/*
+ * Cpu_expand
+ *
+ * Adds the nodes that can be reached in one move from a node: a step
+ * to either side, a step up or down a ladder, a drop through a one-way
+ * tile, and the nearest jump to either side that lands higher up, or
+ * across the gap that the step to that side would fall into.
+ *
+ * i [in]
+ *   Index of the node to expand
+ *
+ * Note: Jumps are modelled as rising straight up as far as
+ *       CPU_JUMP_TILES, and then carrying across at that height as far as
+ *       CPU_JUMP_REACH, which is close enough to the real arc for the
+ *       route to be worth following.
+ */
+static void Cpu_expand(const uint8_t i)
+{
+  cpu.node[i].move |= CPU_CLOSED;
+  const uint8_t x = cpu.node[i].tx;
+  const uint8_t y = cpu.node[i].ty;
+
+  if (isLadder(Cpu_tile(x, y)) && y != 0 && (isLadder(Cpu_tile(x, y - 1)) || Cpu_passable(x, y - 1)))
+    Cpu_add(x, y - 1, i, CPU_CLIMB);
+  if (y + 1 < SCREEN_TILES_V) {
+    const uint8_t below = Cpu_tile(x, y + 1);
+    if (isLadder(below))
+      Cpu_add(x, y + 1, i, CPU_CLIMB);
+    else if (isOneWay(below))
+      Cpu_add(x, Cpu_land(x, y + 1), i, CPU_DROP);
+  }
+
+  uint8_t rise = 0;
+  while (rise < CPU_JUMP_TILES && rise < y && Cpu_passable(x, y - rise - 1))
+    ++rise;
+
+  for (int8_t dir = -1; dir <= 1; dir += 2) {
+    uint8_t walkY = CPU_NONE;
+    if (Cpu_passable(x + dir, y)) {
+      walkY = Cpu_land(x + dir, y);
+      Cpu_add(x + dir, walkY, i, CPU_WALK);
+    }
+    const uint8_t top = y - rise;
+    uint8_t tx = x + dir;
+    for (uint8_t k = 1; rise != 0 && k <= CPU_JUMP_REACH && Cpu_passable(tx, top); ++k, tx += dir) {
+      const uint8_t landY = Cpu_land(tx, top);
+      if (landY < y || (landY == y && k > 1 && walkY != y)) {
+        Cpu_add(tx, landY, i, CPU_JUMP);
+        break;
+      }
+    }
+  }
+}
+
+/*
+ * Cpu_search
+ *
+ * Expands up to CPU_NODES_PER_FRAME nodes of the search for a route to
+ * the goal, always the open node nearest the goal first, and ends the
+ * search once the goal has been reached, or the pool is full, or there
+ * is nothing left to expand. The route then ends at the node that got
+ * nearest the goal.
+ *
+ * Note: Each landing that an expansion looks for reads at most
+ *       CPU_FALL_TILES rows, so no node costs more than CPU_NODE_CYCLES.
+ */
+static void Cpu_search(void)
+{
+  BUILD_BUG_ON(CPU_NODES_PER_FRAME < 1);
+  BUILD_BUG_ON(CPU_NODES > CPU_CLOSED);
+  for (uint8_t budget = CPU_NODES_PER_FRAME; budget != 0; --budget) {
+    uint8_t open = CPU_NONE;
+    uint8_t nearest = CPU_NONE;
+    for (uint8_t i = 0; i < cpu.count; ++i) {
+      const CPU_NODE* const n = &cpu.node[i];
+      if (n->move & CPU_CLOSED)
+        continue;
+      const uint8_t d = Cpu_distance(n->tx, n->ty, cpu.goalX, cpu.goalY);
+      if (d < nearest) {
+        nearest = d;
+        open = i;
+      }
+    }
+    if (open == CPU_NONE || nearest == 0 || cpu.count == CPU_NODES) {
+      cpu.searching = false;
+      return;
+    }
+    Cpu_expand(open);
+  }
+}
+
+// Scans a row of the screen for the treasure nearest (tx, ty), and drops a treasure target that has been collected
+static void Cpu_scan(const uint8_t tx, const uint8_t ty)
+{
+  const uint8_t y = cpu.scanY;
+  uint16_t offset = vramOffset(CPU_LEFT, y);
+  for (uint8_t x = CPU_LEFT; x <= CPU_RIGHT; ++x, offset = vramRight(offset)) {
+    if (isTreasure(vramTile(offset))) {
+      const uint8_t d = Cpu_distance(tx, ty, x, y);
+      uint8_t i = 0;
+      while (i < CPU_SKIPS && !(cpu.skip[i][0] == x && cpu.skip[i][1] == y))
+        ++i;
+      if (d < cpu.scanDistance && i == CPU_SKIPS) {
+        cpu.scanDistance = d;
+        cpu.scanX = x;
+        cpu.scanBestY = y;
+      }
+    }
+  }
+
+  if (cpu.treasureX != CPU_NONE && !isTreasure(Cpu_tile(cpu.treasureX, cpu.treasureY))) {
+    cpu.treasureX = cpu.scanX; // the best of the scan so far, if any, until the scan is done
+    cpu.treasureY = cpu.scanBestY;
+  }
+
+  if (++cpu.scanY == SCREEN_TILES_V) {
+    cpu.treasureX = cpu.scanX;
+    cpu.treasureY = cpu.scanBestY;
+    cpu.scanY = 0;
+    cpu.scanX = CPU_NONE;
+    cpu.scanDistance = CPU_NONE;
+  }
+}
+
+// Starts a search for a route from (tx, ty) to the goal, during which there is no node to head for
+static void Cpu_plan(const uint8_t tx, const uint8_t ty)
+{
+  cpu.node[0].tx = tx;
+  cpu.node[0].ty = ty;
+  cpu.node[0].move = CPU_START;
+  cpu.count = 1;
+  cpu.best = 0;
+  cpu.searching = true;
+  cpu.way = CPU_NONE;
+}
+
+// Leaves a treasure that the entity can't get to alone, until it is replaced by CPU_SKIPS more
+static void Cpu_skip(const uint8_t tx, const uint8_t ty)
+{
+  cpu.skip[cpu.skipNext][0] = tx;
+  cpu.skip[cpu.skipNext][1] = ty;
+  cpu.skipNext = (cpu.skipNext + 1) % CPU_SKIPS;
+  cpu.treasureX = CPU_NONE;
+}
+
+// The node of the route that comes after the one at (tx, ty), or CPU_NONE if (tx, ty) is not on the route, or is its end
+static uint8_t Cpu_follow(const uint8_t tx, const uint8_t ty)
+{
+  for (uint8_t n = cpu.best; n != 0; n = cpu.node[n].parent) {
+    const CPU_NODE* const from = &cpu.node[cpu.node[n].parent];
+    if (from->tx == tx && from->ty == ty)
+      return n;
+  }
+  return CPU_NONE;
+}
+
+// True if nothing is over the entity's head up to row top, the way player_input_buttons checks the row above before it
+// lets it jump, so a jump that the search planned from one column doesn't bump into a ceiling over the next one
+static bool Cpu_headroom(const ENTITY* const e, const uint8_t top)
+{
+  const int16_t roundedX = nearestScreenPixel(e->x) << FP_SHIFT;
+  for (uint8_t ty = p2vt(e->y - 1); ty >= top && ty != CPU_NONE; --ty)
+    if (!Cpu_passable(p2ht(roundedX), ty) || (nh(roundedX) && !Cpu_passable(p2ht(roundedX) + 1, ty)))
+      return false;
+  return true;
+}
+
+// The direction to hold to get from column tx to column to
+#define Cpu_toward(tx, to) (((to) < (tx)) ? BTN_LEFT : ((to) > (tx)) ? BTN_RIGHT : 0)
+
+/*
+ * cpu_input
+ *
+ * Plays a player entity in place of its controller, through
+ * player_input_buttons. It goes after the nearest treasure, or after
+ * player 1 when player 1 is close or there is no treasure left, and
+ * jumps at player 1 to stomp them when it is close enough.
+ *
+ * The route to the target is searched for as many nodes a frame as fit
+ * in CPU_BUDGET_CYCLES at the most each one can cost, and is kept for as long as the target stays on the
+ * same tile, and the entity stays on the route's tiles, so most frames
+ * only follow it. The entity stands still while a new route is being
+ * searched for.
+ *
+ * e [in]
+ *   The player entity to play, which has to be in the array of players,
+ *   since player 1 is found from its tag
+ *
+ * Note: It holds START whenever player 1 does, so player 1 can restart a
+ *       level without a second controller, and holds B once it has died,
+ *       so it respawns.
+ */
+static void cpu_input(ENTITY* const e)
+{
+  const PLAYER* const rival = (const PLAYER*)e - e->tag; // player 1, since the tag of a player is its index
+  uint16_t held = rival->buttons.held & BTN_START;
+  if (e->dead) {
+    player_input_buttons(e, held | BTN_B);
+    return;
+  }
+
+  const uint8_t tx = p2ht(e->x + (WORLD_METER / 2)); // the nearest tile
+  const uint8_t ty = p2vt(e->y + (WORLD_METER / 2));
+  Cpu_scan(tx, ty);
+
+  // Pick the target
+  uint8_t gx = cpu.treasureX;
+  uint8_t gy = cpu.treasureY;
+  bool stomp = false;
+  const ENTITY* const r = (const ENTITY*)rival;
+  if (r != e && r->interacts && !r->dead) {
+    const uint8_t rx = p2ht(r->x + (WORLD_METER / 2));
+    const uint8_t ry = p2vt(r->y + (WORLD_METER / 2));
+    if (gx == CPU_NONE || Cpu_distance(tx, ty, rx, ry) <= CPU_STOMP_TILES) {
+      gx = rx;
+      gy = ry;
+      stomp = true;
+    }
+  }
+
+  const bool settled = (e->update == entity_update_ladder) || (e->update == player_update && !e->jumping && !e->falling);
+  const uint8_t across = (gx > tx) ? gx - tx : tx - gx;
+  if (!settled) {
+    // Keep heading for the same node until the entity lands, since a route can only start from where it can stand,
+    // and keep holding the buttons of a jump that isn't on the route, so it goes as high and as far
+    if (cpu.way == CPU_NONE) {
+      player_input_buttons(e, held | (((const PLAYER*)e)->buttons.held & (BTN_LEFT | BTN_RIGHT | BTN_A)));
+      return;
+    }
+  } else if (gx == CPU_NONE) {
+    cpu.way = CPU_NONE;
+  } else if (stomp && across <= 2 && gy >= ty && gy <= ty + 1) {
+    // Jump at player 1, who is about level with the entity, to come down on top of them
+    player_input_buttons(e, held | Cpu_toward(tx, gx) | (e->jumpReleased ? BTN_A : 0));
+    return;
+  } else if (gx != cpu.goalX || gy != cpu.goalY) {
+    // A new target, so start a new route
+    cpu.goalX = gx;
+    cpu.goalY = gy;
+    Cpu_plan(tx, ty);
+  } else if (!cpu.searching) {
+    const uint8_t way = Cpu_follow(tx, ty);
+    const CPU_NODE* const end = &cpu.node[cpu.best];
+    if (way != cpu.way) {
+      // Only moving on along the route earns more time, and falling back to an earlier node doesn't
+      if (way != CPU_NONE && (cpu.way == CPU_NONE || cpu.node[way].parent == cpu.way))
+        cpu.patience = CPU_PATIENCE_FRAMES;
+      cpu.way = way;
+    }
+    if (way == CPU_NONE && (end->tx != tx || end->ty != ty)) {
+      // Off of the route, so search again from here
+      Cpu_plan(tx, ty);
+    } else if (way == CPU_NONE && (end->tx != gx || end->ty != gy)) {
+      // At the end of a route that falls short of the target, so jump for it if it is in reach, or else give up on it
+      if (across <= 1 && gy < ty && ty - gy <= CPU_JUMP_TILES) {
+        player_input_buttons(e, held | Cpu_toward(tx, gx) | (e->jumpReleased ? BTN_A : 0));
+        return;
+      }
+      if (!stomp)
+        Cpu_skip(gx, gy);
+    } else if (way != CPU_NONE && --cpu.patience == 0) {
+      // The move isn't working out, maybe because of a monster in the way, or a jump that the search got wrong
+      if (!stomp)
+        Cpu_skip(gx, gy);
+      Cpu_plan(tx, ty);
+    }
+  }
+
+  if (cpu.searching)
+    Cpu_search();
+
+  if (cpu.way != CPU_NONE) {
+    const CPU_NODE* const w = &cpu.node[cpu.way];
+    held |= Cpu_toward(tx, w->tx);
+    switch (w->move & ~CPU_CLOSED) {
+    case CPU_JUMP:
+      if (settled && !Cpu_headroom(e, w->ty)) // move over into the tile the jump rises out of
+        held = (held & BTN_START) | ((e->x < ht2p(tx)) ? BTN_RIGHT : BTN_LEFT);
+      else if (!settled || e->jumpReleased) // let go of A for a frame between jumps
+        held |= BTN_A;
+      break;
+    case CPU_CLIMB:
+      held |= (w->ty < ty) ? BTN_UP : BTN_DOWN;
+      break;
+    case CPU_DROP:
+      if (ty <= cpu.node[w->parent].ty) // let go once through, or the entity would drop through every one-way tile below too
+        held |= BTN_DOWN;
+      break;
+    default: // CPU_WALK
+      break;
+    }
+  }
+  player_input_buttons(e, held);
+}
+#else // CPU_OPPONENT
+#define Cpu_begin() ((void)0)
+#endif // CPU_OPPONENT
+
 enum INPUT_FUNCTION;
 typedef enum INPUT_FUNCTION INPUT_FUNCTION;
 
@@ -330,6 +805,7 @@ enum INPUT_FUNCTION {
   AI_FLY_HORIZONTAL_ERRATIC = 11,
   AI_FLY_CIRCLE_CW = 12,
   AI_FLY_CIRCLE_CCW = 13,
+  CPU_INPUT = 14, // plays player 2 against player 1, and only works for a player
 };
 
 typedef void (*inputFnPtr)(ENTITY*);
@@ -363,6 +839,10 @@ static inputFnPtr inputFunc(const INPUT_FUNCTION i)
     return ai_fly_circle_cw;
   case AI_FLY_CIRCLE_CCW:
     return ai_fly_circle_ccw;    
+#if (CPU_OPPONENT == 1)
+  case CPU_INPUT:
+    return cpu_input;
+#endif // CPU_OPPONENT
   default: // NULL_INPUT
     return null_input;
   }
@@ -413,6 +893,7 @@ enum RENDER_FUNCTION {
   ALT_SPIDER_RENDER = 9,
   MOTH_RENDER = 10,
   BUTTERFLY_RENDER = 11,
+  PLATFORM_RENDER = 12,
 };
 
 typedef void (*renderFnPtr)(ENTITY*);
@@ -442,6 +923,10 @@ static renderFnPtr renderFunc(const RENDER_FUNCTION r)
     return moth_render;
   case BUTTERFLY_RENDER:
     return butterfly_render;
+#if (MOVING_PLATFORMS == 1)
+  case PLATFORM_RENDER:
+    return platform_render;
+#endif // MOVING_PLATFORMS
   default: // NULL_RENDER:
     return null_render;
   }
@@ -468,6 +953,8 @@ enum GAME_FLAGS {
   GFLAG_1P = 1,
   GFLAG_2P = 2,
   GFLAG_P1_VS_P2 = 4,
+  GFLAG_ENDLESS = 8, // levels are generated instead of loaded
+  GFLAG_VS_CPU = 16, // player 2 is played by cpu_input
 };
 
 // Parenthesis cannot be placed around this macro expansion
@@ -477,6 +964,74 @@ enum GAME_FLAGS {
 #define THEME_SPACE 1
 #define THEME_GRASS 2
 
+// The theme byte of a level that is several screens wide (see WIDE_LEVELS in entity.h) also holds how many
+// screens it spans. The screens after the first are stored as the levels that follow it, each marked as continued.
+// A level made of rooms (see ROOM_LEVELS in entity.h) stores its rooms the same way, as a grid that is filled in
+// row by row, and the theme byte of its first room also holds how many rooms wide that grid is.
+#define LEVEL_THEME_MASK 0x03
+#define LEVEL_ROOM_COLUMNS(n) (((n) - 1) << 2)
+#define levelRoomColumns(theme) ((((theme) >> 2) & 0x03) + 1)
+#define LEVEL_CONTINUED 0x10
+#define LEVEL_SCREENS(n) (((n) - 1) << 5)
+#define levelScreens(theme) (((theme) >> 5) + 1)
+
+// Builds an int16_t out of its low and high bytes, for fields whose bytes have separate meanings
+#define LOHI(lo, hi) ((int16_t)((lo) | ((hi) << 8)))
+
+enum MONSTER_PROFILES;
+typedef enum MONSTER_PROFILES MONSTER_PROFILES;
+
+// The overrides are numbered after every profile, so an index past the end of monsterProfiles is an override
+enum MONSTER_PROFILES {
+#define MONSTER_PROFILE(name, maxDX, impulse, input, update, render) name,
+#define MONSTER_OVERRIDE(name, profile, maxDX, impulse)
+#include "data/monster_profiles.inc"
+#undef MONSTER_OVERRIDE
+#undef MONSTER_PROFILE
+#define MONSTER_PROFILE(name, maxDX, impulse, input, update, render)
+#define MONSTER_OVERRIDE(name, profile, maxDX, impulse) name,
+#include "data/monster_profiles.inc"
+#undef MONSTER_OVERRIDE
+#undef MONSTER_PROFILE
+  MONSTER_PROFILES_N
+};
+
+struct MONSTER_PROFILE;
+typedef struct MONSTER_PROFILE MONSTER_PROFILE;
+
+struct MONSTER_PROFILE {
+  int16_t maxDX;
+  int16_t impulse;
+  uint8_t input;
+  uint8_t update;
+  uint8_t render;
+} __attribute__ ((packed));
+
+const MONSTER_PROFILE monsterProfiles[] PROGMEM = {
+#define MONSTER_PROFILE(name, maxDX, impulse, input, update, render) { (maxDX), (impulse), (input), (update), (render) },
+#define MONSTER_OVERRIDE(name, profile, maxDX, impulse)
+#include "data/monster_profiles.inc"
+#undef MONSTER_OVERRIDE
+#undef MONSTER_PROFILE
+};
+
+struct MONSTER_OVERRIDE;
+typedef struct MONSTER_OVERRIDE MONSTER_OVERRIDE;
+
+struct MONSTER_OVERRIDE {
+  uint8_t profile;
+  int16_t maxDX;
+  int16_t impulse;
+} __attribute__ ((packed));
+
+const MONSTER_OVERRIDE monsterOverrides[] PROGMEM = {
+#define MONSTER_PROFILE(name, maxDX, impulse, input, update, render)
+#define MONSTER_OVERRIDE(name, profile, maxDX, impulse) { (profile), (maxDX), (impulse) },
+#include "data/monster_profiles.inc"
+#undef MONSTER_OVERRIDE
+#undef MONSTER_PROFILE
+};
+
 const uint8_t levelData[] PROGMEM = {
   LEVELS,      // uint8_t numLevels
 
@@ -551,6 +1106,35 @@ const uint8_t levelData[] PROGMEM = {
 #include "data/levels/0210-dodge_the_fire_level.inc"
 #include "editor/levels/0210-dodge_the_fire_level.xcf.png.inc"
 
+#include "data/levels/0211-crumbling_ledges_level.inc"
+#include "editor/levels/0211-crumbling_ledges_level.xcf.png.inc"
+
+#if (MOVING_PLATFORMS == 1)
+  // A level crossed by riding a moving platform and a lift, which "make levels" only exports for a MOVING_PLATFORMS build
+#include "data/levels/platforms/0215-moving_platforms_level.inc"
+#include "editor/levels/0215-moving_platforms_level.xcf.png.inc"
+#endif // MOVING_PLATFORMS
+
+#if (WIDE_LEVELS == 1)
+  // A level two screens wide, which "make levels" only exports for a WIDE_LEVELS build
+#include "data/levels/wide/0220-wide_meadow_level.inc"
+#include "editor/levels/0220-wide_meadow_level.xcf.png.inc"
+#include "data/levels/wide/0221-wide_meadow_level_2.inc"
+#include "editor/levels/0221-wide_meadow_level_2.xcf.png.inc"
+#endif // WIDE_LEVELS
+
+#if (ROOM_LEVELS == 1)
+  // A level made of two rows of two rooms, which "make levels" only exports for a ROOM_LEVELS build
+#include "data/levels/rooms/0230-four_rooms_level.inc"
+#include "editor/levels/0230-four_rooms_level.xcf.png.inc"
+#include "data/levels/rooms/0231-four_rooms_level_2.inc"
+#include "editor/levels/0231-four_rooms_level_2.xcf.png.inc"
+#include "data/levels/rooms/0232-four_rooms_level_3.inc"
+#include "editor/levels/0232-four_rooms_level_3.xcf.png.inc"
+#include "data/levels/rooms/0233-four_rooms_level_4.inc"
+#include "editor/levels/0233-four_rooms_level_4.xcf.png.inc"
+#endif // ROOM_LEVELS
+
   // Victory screen
 #include "data/levels/9999-victory_level.inc"
 #include "editor/levels/9999-victory_level.xcf.png.inc"
@@ -571,19 +1155,16 @@ const uint8_t levelData[] PROGMEM = {
 #define LEVEL_PLAYER_RENDER_SIZE 2
 #define LEVEL_MONSTER_INITIAL_FLAGS_START (LEVEL_PLAYER_RENDER_START + LEVEL_PLAYER_RENDER_SIZE)
 #define LEVEL_MONSTER_INITIAL_FLAGS_SIZE 6
-#define LEVEL_MONSTER_MAXDX_START (LEVEL_MONSTER_INITIAL_FLAGS_START + LEVEL_MONSTER_INITIAL_FLAGS_SIZE)
-#define LEVEL_MONSTER_MAXDX_SIZE (6 * sizeof(int16_t))
-#define LEVEL_MONSTER_IMPULSE_START (LEVEL_MONSTER_MAXDX_START + LEVEL_MONSTER_MAXDX_SIZE)
-#define LEVEL_MONSTER_IMPULSE_SIZE (6 * sizeof(int16_t))
-#define LEVEL_MONSTER_INPUT_START (LEVEL_MONSTER_IMPULSE_START + LEVEL_MONSTER_IMPULSE_SIZE)
-#define LEVEL_MONSTER_INPUT_SIZE 6
-#define LEVEL_MONSTER_UPDATE_START (LEVEL_MONSTER_INPUT_START + LEVEL_MONSTER_INPUT_SIZE)
-#define LEVEL_MONSTER_UPDATE_SIZE 6
-#define LEVEL_MONSTER_RENDER_START (LEVEL_MONSTER_UPDATE_START + LEVEL_MONSTER_UPDATE_SIZE)
-#define LEVEL_MONSTER_RENDER_SIZE 6
-#define LEVEL_MAP_START (LEVEL_MONSTER_RENDER_START + LEVEL_MONSTER_RENDER_SIZE)
+#define LEVEL_MONSTER_PROFILE_START (LEVEL_MONSTER_INITIAL_FLAGS_START + LEVEL_MONSTER_INITIAL_FLAGS_SIZE)
+#define LEVEL_MONSTER_PROFILE_SIZE 6
+#if (LEVEL_MAP_COMPRESSED == 1)
+// The compressed base map has a variable length, so png2inc stores it after the packed coordinates
+#define LEVEL_TREASURE_COUNT_START (LEVEL_MONSTER_PROFILE_START + LEVEL_MONSTER_PROFILE_SIZE)
+#else // LEVEL_MAP_COMPRESSED
+#define LEVEL_MAP_START (LEVEL_MONSTER_PROFILE_START + LEVEL_MONSTER_PROFILE_SIZE)
 #define LEVEL_MAP_SIZE 105
 #define LEVEL_TREASURE_COUNT_START (LEVEL_MAP_START + LEVEL_MAP_SIZE)
+#endif // LEVEL_MAP_COMPRESSED
 #define LEVEL_TREASURE_COUNT_SIZE 1
 #define LEVEL_ONE_WAY_COUNT_START (LEVEL_TREASURE_COUNT_START + LEVEL_TREASURE_COUNT_SIZE)
 #define LEVEL_ONE_WAY_COUNT_SIZE 1
@@ -593,24 +1174,104 @@ const uint8_t levelData[] PROGMEM = {
 #define LEVEL_FIRE_COUNT_SIZE 1
 #define LEVEL_PACKED_COORDINATES_START (LEVEL_FIRE_COUNT_START + LEVEL_FIRE_COUNT_SIZE)
 
-#define numLevels() ((uint8_t)pgm_read_byte(&levelData[0]))
+#if (LEVEL_PACK == 1)
+#include <petitfatfs/pff.h>
+
+// The level pack uses the same layout as levelData: the number of levels, a table of uint16_t offsets, then the levels themselves
+#define LEVEL_PACK_FILENAME "LEVELS.PAK"
+// Every level must fit into the cache, which is taken out of RAM for the whole game (see LEVEL_CACHE_SIZE in default/Makefile)
+#ifndef LEVEL_CACHE_SIZE
+#define LEVEL_CACHE_SIZE 288
+#endif // LEVEL_CACHE_SIZE
+
+static FATFS levelPackFs;
+static uint8_t levelPackLevels; // 0 when no level pack was found, so the built-in levels are used
+static uint8_t levelCache[LEVEL_CACHE_SIZE];
+
+#define levelBytes levelCache
+#define numLevels() (levelPackLevels ? levelPackLevels : LEVELS)
+#else // LEVEL_PACK
+#define levelBytes levelData
+#define numLevels() LEVELS
+#endif // LEVEL_PACK
+
 #define levelOffset(level) ((uint16_t)pgm_read_word(&levelData[LEVEL_HEADER_SIZE + ((level) * sizeof(uint16_t))]))
-#define theme(levelOffset) ((uint8_t)pgm_read_byte(&levelData[(levelOffset) + LEVEL_THEME_START]))
-#define timeBonus(levelOffset) ((uint16_t)pgm_read_word(&levelData[(levelOffset) + LEVEL_TIME_BONUS_START]))
-#define playerFlags(levelOffset, i) ((uint8_t)pgm_read_byte(&levelData[(levelOffset) + LEVEL_PLAYER_INITIAL_FLAGS_START + (i)]))
-#define playerInput(levelOffset, i) ((uint8_t)pgm_read_byte(&levelData[(levelOffset) + LEVEL_PLAYER_INPUT_START + (i)]))
-#define playerUpdate(levelOffset, i) ((uint8_t)pgm_read_byte(&levelData[(levelOffset) + LEVEL_PLAYER_UPDATE_START + (i)]))
-#define playerRender(levelOffset, i) ((uint8_t)pgm_read_byte(&levelData[(levelOffset) + LEVEL_PLAYER_RENDER_START + (i)]))
-#define monsterFlags(levelOffset, i) ((uint8_t)pgm_read_byte(&levelData[(levelOffset) + LEVEL_MONSTER_INITIAL_FLAGS_START + (i)]))
-#define monsterMaxDX(levelOffset, i) ((int16_t)pgm_read_word(&levelData[(levelOffset) + LEVEL_MONSTER_MAXDX_START + ((i) * sizeof(int16_t))]))
-#define monsterImpulse(levelOffset, i) ((int16_t)pgm_read_word(&levelData[(levelOffset) + LEVEL_MONSTER_IMPULSE_START + ((i) * sizeof(int16_t))]))
-#define monsterInput(levelOffset, i) ((uint8_t)pgm_read_byte(&levelData[(levelOffset) + LEVEL_MONSTER_INPUT_START + (i)]))
-#define monsterUpdate(levelOffset, i) ((uint8_t)pgm_read_byte(&levelData[(levelOffset) + LEVEL_MONSTER_UPDATE_START + (i)]))
-#define monsterRender(levelOffset, i) ((uint8_t)pgm_read_byte(&levelData[(levelOffset) + LEVEL_MONSTER_RENDER_START + (i)]))
-#define treasureCount(levelOffset) ((uint8_t)pgm_read_byte(&levelData[(levelOffset) + LEVEL_TREASURE_COUNT_START]))
-#define onewayCount(levelOffset) ((uint8_t)pgm_read_byte(&levelData[(levelOffset) + LEVEL_ONE_WAY_COUNT_START]))
-#define ladderCount(levelOffset) ((uint8_t)pgm_read_byte(&levelData[(levelOffset) + LEVEL_LADDER_COUNT_START]))
-#define fireCount(levelOffset) ((uint8_t)pgm_read_byte(&levelData[(levelOffset) + LEVEL_FIRE_COUNT_START]))
+#define treasureCount(levelOffset) ((uint8_t)levelReadByte(&levelBytes[(levelOffset) + LEVEL_TREASURE_COUNT_START]))
+#define onewayCount(levelOffset) ((uint8_t)levelReadByte(&levelBytes[(levelOffset) + LEVEL_ONE_WAY_COUNT_START]))
+#define ladderCount(levelOffset) ((uint8_t)levelReadByte(&levelBytes[(levelOffset) + LEVEL_LADDER_COUNT_START]))
+#define fireCount(levelOffset) ((uint8_t)levelReadByte(&levelBytes[(levelOffset) + LEVEL_FIRE_COUNT_START]))
+
+#if (LEVEL_PACK == 1)
+/*
+ * LevelPack_open
+ *
+ * Mounts the SD card, and opens the level pack
+ *
+ * Returns:
+ *   The number of levels in the level pack, or 0 if there is no SD
+ *   card, or it does not contain a level pack.
+ */
+__attribute__(( optimize("Os") ))
+static uint8_t LevelPack_open(void)
+{
+  uint8_t levels;
+  UINT bytesRead;
+  if (pf_mount(&levelPackFs) != FR_OK ||
+      pf_open(LEVEL_PACK_FILENAME) != FR_OK ||
+      pf_read(&levels, sizeof(levels), &bytesRead) != FR_OK ||
+      bytesRead != sizeof(levels))
+    return 0;
+  return levels;
+}
+
+/*
+ * LevelCache_fill
+ *
+ * Copies a level into levelCache, streaming it from the level pack if
+ * one is open, or from the built-in levelData otherwise
+ *
+ * level [in]
+ *   The level to copy, which must be less than numLevels()
+ *
+ * Returns:
+ *   A boolean that is true if the entire level was copied, or false if
+ *   it could not be read, or is larger than LEVEL_CACHE_SIZE.
+ */
+__attribute__(( optimize("Os") ))
+static bool LevelCache_fill(const uint8_t level)
+{
+  uint16_t start;
+  uint16_t end;
+
+  if (levelPackLevels) {
+    uint16_t offsets[2];
+    UINT bytesRead;
+    if (pf_lseek(LEVEL_HEADER_SIZE + level * sizeof(uint16_t)) != FR_OK ||
+        pf_read(offsets, sizeof(offsets), &bytesRead) != FR_OK)
+      return false;
+    start = offsets[0];
+    end = (level == levelPackLevels - 1) ? (uint16_t)levelPackFs.fsize : offsets[1];
+  } else {
+    start = levelOffset(level);
+    end = (level == LEVELS - 1) ? sizeof(levelData) : levelOffset(level + 1);
+  }
+
+  if (end < start || end - start > LEVEL_CACHE_SIZE)
+    return false;
+  const uint16_t size = end - start;
+
+  if (levelPackLevels) {
+    UINT bytesRead;
+    if (pf_lseek(start) != FR_OK ||
+        pf_read(levelCache, size, &bytesRead) != FR_OK ||
+        bytesRead != size)
+      return false;
+  } else {
+    memcpy_P(levelCache, &levelData[start], size);
+  }
+  return true;
+}
+#endif // LEVEL_PACK
 
 const uint8_t MapTileToLadderTop[] PROGMEM = {
   // If a ladder top overlaps a treasure tile, the treasure gets replaced with open sky and gets a ladder top overlaid
@@ -668,7 +1329,8 @@ const uint8_t MapTileToLadderMiddle[] PROGMEM = {
   15 + ABOVEGROUND_ONE_WAY_TO_ABOVEGROUND_ONE_WAY_LADDER_TOP_OFFSET,
 };
 
-#define BaseMapIsSolid PgmBitArray_readBit
+// While the base map is being decoded and autotiled, vram only contains underground, aboveground, and sky tiles
+#define BaseMapIsSolid(t) isSolid((t) - RAM_TILES_COUNT)
 
 __attribute__(( optimize("Os") ))
 static void DrawTreasure(const uint8_t x, const uint8_t y)
@@ -680,13 +1342,14 @@ static void DrawTreasure(const uint8_t x, const uint8_t y)
 }
 
 __attribute__(( optimize("Os") ))
-static void DrawOneWay(const uint8_t y, const uint8_t x1, const uint8_t x2, const uint8_t* const map)
+static void DrawOneWay(const uint8_t y, const uint8_t x1, const uint8_t x2)
 {
   // In this function, using GetTile/SetTile produces smaller code than using vram directly
   if ((y < SCREEN_TILES_V) && (x1 < SCREEN_TILES_H) && (x2 < SCREEN_TILES_H)) {
     for (uint8_t x = x1; x <= x2; ++x) {
       uint8_t t = GetTile(x, y);
-      if ((t >= FIRST_ABOVEGROUND_TILE) && (t <= LAST_ABOVEGROUND_TILE) && ((y == SCREEN_TILES_V) || !BaseMapIsSolid(map, (y + 1) * SCREEN_TILES_H + x)))
+      // Oneways are drawn from top to bottom, so the row below still holds the autotiled base map
+      if ((t >= FIRST_ABOVEGROUND_TILE) && (t <= LAST_ABOVEGROUND_TILE) && ((y == SCREEN_TILES_V - 1) || !isSolid(GetTile(x, y + 1))))
         SetTile(x, y, t + ABOVEGROUND_TO_ABOVEGROUND_ONE_WAY_OFFSET);
     }
   }
@@ -727,44 +1390,84 @@ static void DrawFire(const uint8_t y, const uint8_t x1, const uint8_t x2)
 #define MAX_PLAYERS 2
 #define MAX_MONSTERS 6
 
-__attribute__(( always_inline ))
-static inline void entityInitialXY(const uint16_t levelOffset, const uint8_t i, uint8_t* const x, uint8_t* const y)
+struct LEVEL_HEADER;
+typedef struct LEVEL_HEADER LEVEL_HEADER;
+
+// RAM copy of the fixed-size part of a level (theme through monsterProfile), so spawning never touches flash for these fields
+struct LEVEL_HEADER {
+  uint8_t theme;
+  uint16_t timeBonus;
+  uint8_t playerFlags[MAX_PLAYERS];
+  uint8_t playerInput[MAX_PLAYERS];
+  uint8_t playerUpdate[MAX_PLAYERS];
+  uint8_t playerRender[MAX_PLAYERS];
+  uint8_t monsterFlags[MAX_MONSTERS];
+  uint8_t monsterProfile[MAX_MONSTERS];
+} __attribute__ ((packed));
+
+#if (LEVEL_MAP_COMPRESSED == 1)
+/*
+ * DecodeMap
+ *
+ * Streams a base map that was compressed by png2inc directly into vram
+ *
+ * map [in]
+ *   The compressed map in level data. Each cell is stored as the XOR of
+ *   itself with the cell above it, and those bits are run-length encoded
+ *   as nibbles (high nibble first). A nibble of 15 is a run of 15 that
+ *   continues the current value, and a nibble n in 0-14 is a run of n
+ *   followed by a toggle of the current value.
+ *
+ *   Note: The row above is read back out of vram, so the only state
+ *         kept is the current run.
+ */
+__attribute__(( optimize("Os") ))
+static void DecodeMap(const uint8_t* const map)
 {
-  const uint8_t* packedCoordinatesStart = &levelData[levelOffset + LEVEL_PACKED_COORDINATES_START];
-  *x = PgmPacked5Bit_read(packedCoordinatesStart, i * 2);
-  *y = PgmPacked5Bit_read(packedCoordinatesStart, i * 2 + 1);
+  uint16_t nibble = 0;
+  uint8_t run = 0;
+  bool value = false;
+  bool toggle = false;
+  for (uint16_t offset = 0; offset < SCREEN_TILES_H * SCREEN_TILES_V; ++offset) {
+    while (run == 0) {
+      if (toggle)
+        value = !value;
+      uint8_t b = levelReadByte(map + (nibble >> 1));
+      run = (nibble & 1) ? (b & 0x0F) : (b >> 4);
+      toggle = (run != 15);
+      ++nibble;
+    }
+    --run;
+    bool solid = value ^ ((offset >= SCREEN_TILES_H) && BaseMapIsSolid(vram[offset - SCREEN_TILES_H]));
+    vram[offset] = (solid ? FIRST_UNDERGROUND_TILE : FIRST_SKY_TILE) + RAM_TILES_COUNT;
+  }
 }
-
-// Returns offset into levelData PROGMEM array
+#else // LEVEL_MAP_COMPRESSED
+// Expands the uncompressed base map (1 bit per tile) into solid/sky markers in vram
 __attribute__(( optimize("Os") ))
-static uint16_t LoadLevel(const uint8_t level, uint8_t* const theme, uint8_t* const treasures, uint16_t* const timeBonus)
+static void DecodeMap(const uint8_t* const map)
 {
-  // Bounds check level
-  if (level >= LEVELS)
-    return 0xFFFF; // bogus value
-
-  // Determine the offset into the PROGMEM array where the level data begins
-  const uint16_t levelOffset = levelOffset(level);
-
-  // Using that offset, read the theme, and draw the base map
-  *theme = theme(levelOffset);
-  if (*theme >= THEMES_N) // something major went wrong
-    return 0xFFFF; // bogus value
-
-  SetTileTable(tileset + (TILE_WIDTH * TILE_HEIGHT) * ((TILESET_SIZE - TITLE_SCREEN_TILES) / (THEMES_N)) * *theme);
-
-  *timeBonus = timeBonus(levelOffset) + 1;
-  if (*timeBonus > 999)
-    *timeBonus = 999;
-
-  const uint8_t* const map = &levelData[levelOffset + LEVEL_MAP_START];
+  uint16_t offset = 0;
+  for (uint8_t i = 0; i < LEVEL_MAP_SIZE; ++i) {
+    uint8_t bits = levelReadByte(map + i);
+    for (uint8_t j = 0; j < 8; ++j) {
+      vram[offset++] = ((bits & 1) ? FIRST_UNDERGROUND_TILE : FIRST_SKY_TILE) + RAM_TILES_COUNT;
+      bits >>= 1;
+    }
+  }
+}
+#endif // LEVEL_MAP_COMPRESSED
 
+// Autotiles the base map in place. The row above has already been autotiled, and the row below
+// still holds the solid/sky markers written by DecodeMap, so both can be tested with BaseMapIsSolid.
+__attribute__(( optimize("Os") ))
+static void AutotileMap(void)
+{
+  uint16_t offset = 0;
   for (uint8_t y = 0; y < SCREEN_TILES_V; ++y) {
-    for (uint8_t x = 0; x < SCREEN_TILES_H; ++x) {
-      uint16_t offset = y * SCREEN_TILES_H + x;
-
-      if (BaseMapIsSolid(map, offset/* x, y */)) {
-        if (y == 0 || BaseMapIsSolid(map, offset - SCREEN_TILES_H/* x, y - 1 */)) { // if we are the top tile, or there is a solid tile above us
+    for (uint8_t x = 0; x < SCREEN_TILES_H; ++x, ++offset) {
+      if (BaseMapIsSolid(vram[offset]/* x, y */)) {
+        if (y == 0 || BaseMapIsSolid(vram[offset - SCREEN_TILES_H]/* x, y - 1 */)) { // if we are the top tile, or there is a solid tile above us
           vram[offset] = FIRST_UNDERGROUND_TILE + RAM_TILES_COUNT; // underground tile
         } else {
           vram[offset] = FIRST_ABOVEGROUND_TILE + RAM_TILES_COUNT; // aboveground tile
@@ -773,9 +1476,9 @@ static uint16_t LoadLevel(const uint8_t level, uint8_t* const theme, uint8_t* co
         if (y == SCREEN_TILES_V - 1) { // holes in the bottom border are always full sky tiles
           vram[offset] = FIRST_SKY_TILE + RAM_TILES_COUNT; // full sky tile
         } else { // interior tile
-          bool solidLDiag = (bool)((x == 0) || BaseMapIsSolid(map, offset + SCREEN_TILES_H - 1/* x - 1, y + 1 */));
-          bool solidRDiag = (bool)((x == SCREEN_TILES_H - 1) || BaseMapIsSolid(map, offset + SCREEN_TILES_H + 1/* x + 1, y + 1 */));
-          bool solidBelow = BaseMapIsSolid(map, offset + SCREEN_TILES_H/* x, y + 1 */);
+          bool solidLDiag = (bool)((x == 0) || BaseMapIsSolid(vram[offset + SCREEN_TILES_H - 1]/* x - 1, y + 1 */));
+          bool solidRDiag = (bool)((x == SCREEN_TILES_H - 1) || BaseMapIsSolid(vram[offset + SCREEN_TILES_H + 1]/* x + 1, y + 1 */));
+          bool solidBelow = BaseMapIsSolid(vram[offset + SCREEN_TILES_H]/* x, y + 1 */);
 
           if (!solidLDiag && !solidRDiag && solidBelow) // island
             vram[offset] = 1 + FIRST_SKY_TILE + RAM_TILES_COUNT;
@@ -791,53 +1494,1865 @@ static uint16_t LoadLevel(const uint8_t level, uint8_t* const theme, uint8_t* co
       }
     }
   }
+}
 
-  // Overlay treasures, oneways, ladders, and fires
-  const uint8_t* packedCoordinatesStart = &levelData[levelOffset + LEVEL_PACKED_COORDINATES_START];
-  uint16_t packedOffset = MAX_PLAYERS * 2 + MAX_MONSTERS * 2; // 2 coordinates per player, 2 coordinates per monster
-  *treasures = treasureCount(levelOffset);
-  for (uint8_t i = 0; i < *treasures; ++i) {
-    const uint8_t x = PgmPacked5Bit_read(packedCoordinatesStart, packedOffset + i * 2);
-    const uint8_t y = PgmPacked5Bit_read(packedCoordinatesStart, packedOffset + i * 2 + 1);
-    DrawTreasure(x, y);
-  }
-  packedOffset += *treasures * 2; // 2 coordinates per treasure
-  const uint8_t oneways = onewayCount(levelOffset);
-  for (uint8_t i = 0; i < oneways; ++i) {
-    const uint8_t y = PgmPacked5Bit_read(packedCoordinatesStart, packedOffset + i * 3);
-    const uint8_t x1 = PgmPacked5Bit_read(packedCoordinatesStart, packedOffset + i * 3 + 1);
-    const uint8_t x2 = PgmPacked5Bit_read(packedCoordinatesStart, packedOffset + i * 3 + 2);
-    DrawOneWay(y, x1, x2, map);
-  }
-  packedOffset += oneways * 3; // 3 coordinates per oneway
-  const uint8_t ladders = ladderCount(levelOffset);
-  for (uint8_t i = 0; i < ladders; ++i) {
-    const uint8_t x = PgmPacked5Bit_read(packedCoordinatesStart, packedOffset + i * 3);
-    const uint8_t y1 = PgmPacked5Bit_read(packedCoordinatesStart, packedOffset + i * 3 + 1);
-    const uint8_t y2 = PgmPacked5Bit_read(packedCoordinatesStart, packedOffset + i * 3 + 2);
-    DrawLadder(x, y1, y2);
-  }
-  packedOffset += ladders * 3; // 3 coordinates per ladder
-  const uint8_t fires = fireCount(levelOffset);
-  for (uint8_t i = 0; i < fires; ++i) {
-    const uint8_t y = PgmPacked5Bit_read(packedCoordinatesStart, packedOffset + i * 3);
-    const uint8_t x1 = PgmPacked5Bit_read(packedCoordinatesStart, packedOffset + i * 3 + 1);
-    const uint8_t x2 = PgmPacked5Bit_read(packedCoordinatesStart, packedOffset + i * 3 + 2);
-    DrawFire(y, x1, x2);
+// Set to 0 to leave out the endless mode, which plays levels generated from a 16-bit seed
+#ifndef LEVEL_GENERATOR
+#define LEVEL_GENERATOR 1
+#endif // LEVEL_GENERATOR
+
+#if (LEVEL_GENERATOR == 1)
+// The levelOffset of a generated level, which keeps the initial positions of its monsters in RAM
+#define GENERATED_LEVEL_OFFSET 0xFFFE
+static uint16_t endlessSeed; // seed of the current generated level, chosen by how long the title screen was shown
+#define victoryLevel(gameType) (((gameType) & GFLAG_ENDLESS) ? 0xFF : numLevels() - 1)
+#else // LEVEL_GENERATOR
+#define victoryLevel(gameType) (numLevels() - 1)
+#endif // LEVEL_GENERATOR
+
+#if (WIDE_LEVELS == 1) || (ROOM_LEVELS == 1)
+// Levels that span several screens keep which of their treasures have been collected, since the screen a
+// treasure is on can be drawn again after it has been collected
+#define LEVEL_MAX_SCREENS 8 // keeps the width of a wide level in a uint8_t
+#define LEVEL_MAX_TREASURES 128
+
+static uint16_t screenOffset[LEVEL_MAX_SCREENS];      // levelOffset of each screen of the current level
+static uint8_t screenTreasureBase[LEVEL_MAX_SCREENS]; // index of the first treasure of each screen, into treasureTaken
+static uint8_t treasureTaken[LEVEL_MAX_TREASURES / 8];
+static uint8_t levelSpan = 1;                         // number of levels (screens) the current level uses
+
+#define treasureIsTaken(index) ((bool)(treasureTaken[(index) >> 3] & (1 << ((index) & 7))))
+#define levelTheme(level) pgm_read_byte(&levelData[levelOffset(level) + LEVEL_THEME_START])
+
+/*
+ * Level_gatherScreens
+ *
+ * Finds every screen of a level that spans several, and marks all of
+ * their treasures as not collected
+ *
+ * level [in]
+ *   The first screen of the level
+ *
+ * screens [in]
+ *   How many screens the level spans
+ *
+ * Returns:
+ *   The number of treasures in the whole level
+ */
+__attribute__(( optimize("Os") ))
+static uint8_t Level_gatherScreens(const uint8_t level, const uint8_t screens)
+{
+  levelSpan = screens;
+  memset(treasureTaken, 0, sizeof(treasureTaken));
+  uint8_t treasures = 0;
+  for (uint8_t s = 0; s < screens; ++s) {
+    screenOffset[s] = levelOffset(level + s);
+    screenTreasureBase[s] = treasures;
+    treasures += treasureCount(screenOffset[s]);
   }
+  if (treasures > LEVEL_MAX_TREASURES)
+    treasures = LEVEL_MAX_TREASURES; // the level can't be finished, but nothing is written out of bounds
+  return treasures;
+}
 
-  return levelOffset;
+// Marks the treasure at tile (x, y) of a screen as collected, so it stays collected when that screen is drawn again
+__attribute__(( optimize("Os") ))
+static void Level_takeTreasure(const uint8_t screen, const uint8_t x, const uint8_t y)
+{
+  const uint16_t levelOffset = screenOffset[screen];
+  const uint8_t* packedCoordinatesStart = &levelData[levelOffset + LEVEL_PACKED_COORDINATES_START];
+  const uint8_t treasures = treasureCount(levelOffset);
+  uint16_t packedOffset = MAX_PLAYERS * 2 + MAX_MONSTERS * 2;
+  for (uint8_t i = 0; i < treasures; ++i, packedOffset += 2) {
+    if (PgmPacked5Bit_read(packedCoordinatesStart, packedOffset) == x &&
+        PgmPacked5Bit_read(packedCoordinatesStart, packedOffset + 1) == y) {
+      const uint8_t index = screenTreasureBase[screen] + i;
+      if (index < LEVEL_MAX_TREASURES)
+        treasureTaken[index >> 3] |= (1 << (index & 7));
+      return;
+    }
+  }
 }
+#else // WIDE_LEVELS || ROOM_LEVELS
+#define levelSpan 1
+#endif // WIDE_LEVELS || ROOM_LEVELS
+
+// Set to 0 to leave out tiles that crumble after a player stands on them, or break when a player jumps into them
+#ifndef BREAKABLE_TILES
+#define BREAKABLE_TILES 1
+#endif // BREAKABLE_TILES
+
+#if (BREAKABLE_TILES == 1)
+#define BREAKABLE_CRUMBLE 0x20
+#define BREAKABLE_BUMP 0x40
+#define BREAKABLE_Y_MASK 0x1F
+#define BREAKABLE_MAX_RUNS 8         // runs of breakable tiles in the level being played
+#define BREAKABLE_MAX_BROKEN 32      // tiles that can be broken before the level is loaded again
+#define BREAKABLE_MAX_CRUMBLING 4    // tiles that can be crumbling at the same time
+#define BREAKABLE_CRUMBLE_FRAMES 20  // how long a tile holds up after a player first stands on it
+
+#include "data/breakables.inc"
+
+struct BREAKABLE_RUN;
+typedef struct BREAKABLE_RUN BREAKABLE_RUN;
+
+struct BREAKABLE_RUN {
+  uint8_t screen; // the room the run is in, or 0 (the x coordinates of a wide level span every screen)
+  uint8_t y;      // class | y
+  uint8_t x1;
+  uint8_t x2;
+};
 
-// How many frames to wait between animating treasure
-#define BACKGROUND_FRAME_SKIP 8
-// Defines the order in which the tileset "rows" are swapped in for animating tiles
-const uint8_t backgroundAnimation[] PROGMEM = { 0, 1, 2, 1 };
+struct BREAKABLE_CELL;
+typedef struct BREAKABLE_CELL BREAKABLE_CELL;
+
+struct BREAKABLE_CELL {
+  uint8_t screen; // same as BREAKABLE_RUN
+  uint8_t x;
+  uint8_t y;
+};
+
+// Everything that changes a level's tiles, other than collecting treasure, goes through these lists, so drawing
+// the level again only has to look at the tiles that changed, instead of at every tile of the level
+static BREAKABLE_RUN breakableRun[BREAKABLE_MAX_RUNS];
+static union {
+  BREAKABLE_CELL cell[BREAKABLE_MAX_BROKEN];
+#if (LEVEL_GENERATOR == 1)
+  uint8_t generatedXY[MAX_MONSTERS][2]; // where the monsters of a generated level start, which has no breakable runs
+#endif // LEVEL_GENERATOR
+} brokenCell;
+static BREAKABLE_CELL crumblingCell[BREAKABLE_MAX_CRUMBLING];
+static uint8_t crumblingFrames[BREAKABLE_MAX_CRUMBLING];
+static uint8_t breakableRuns;
+static uint8_t brokenCells;
+static uint8_t crumblingCells;
+#endif // BREAKABLE_TILES
+
+#if (LEVEL_GENERATOR == 1)
+// The players of a generated level start at opposite ends of the ground
+#define generatedPlayerX(i) (((i) & 1) ? SCREEN_TILES_H - 3 : 2)
+#define generatedPlayerY(i) (SCREEN_TILES_V - 2)
+#if (BREAKABLE_TILES == 1)
+// A generated level has no breakable runs, so nothing in it can break, and it keeps where its monsters start in the
+// union with the list of broken tiles
+#define generatedXY brokenCell.generatedXY
+#else // BREAKABLE_TILES
+static uint8_t generatedXY[MAX_MONSTERS][2];
+#endif // BREAKABLE_TILES
+#endif // LEVEL_GENERATOR
+
+#if (WIDE_LEVELS == 1)
+#if (LEVEL_MAP_COMPRESSED == 1) || (LEVEL_PACK == 1) || (LEVEL_GENERATOR == 1)
+#error WIDE_LEVELS streams columns out of the uncompressed built-in base maps, so LEVEL_MAP_COMPRESSED, LEVEL_PACK, and LEVEL_GENERATOR must be 0
+#endif
+#define LEVEL_SCREEN_TILES_H 30 // width of each screen of level data, which can be wider than what is visible
+
+static uint8_t wideXY[MAX_PLAYERS + MAX_MONSTERS][2]; // initial positions in world tiles, since 5 bits only span one screen
+static uint8_t hudRow[VRAM_TILES_H];                  // top row of each resident column, from under the score display
+#if (PROFILE == 1)
+static uint16_t streamCostMax;                        // most flash reads a single column has taken to stream in
+#endif // PROFILE
+
+#define collectTreasure(offset, tx, ty) do { vram[(offset)] += TREASURE_TO_SKY_OFFSET; \
+    Level_takeTreasure(screenToWorldX(tx) / LEVEL_SCREEN_TILES_H, screenToWorldX(tx) % LEVEL_SCREEN_TILES_H, (ty)); } while (0)
+
+// Returns one bit per row of the base map of world column x, treating everything outside of the level as solid
+__attribute__(( optimize("Os") ))
+static uint32_t WideMap_column(const uint8_t x)
+{
+  if (x >= levelTilesH)
+    return 0xFFFFFFFF;
+
+  BUILD_BUG_ON(SCREEN_TILES_V > 32);
+  const uint8_t* const map = &levelData[screenOffset[x / LEVEL_SCREEN_TILES_H] + LEVEL_MAP_START];
+  uint16_t bit = x % LEVEL_SCREEN_TILES_H;
+  uint32_t column = 0;
+  for (uint8_t y = 0; y < SCREEN_TILES_V; ++y, bit += LEVEL_SCREEN_TILES_H)
+    if (pgm_read_byte(map + (bit >> 3)) & (1 << (bit & 7)))
+      column |= ((uint32_t)1 << y);
+  return column;
+}
+
+#define columnBit(column, y) ((bool)((column) & ((uint32_t)1 << (y))))
+
+#if (BREAKABLE_TILES == 1)
+// Returns one bit per row of world column x, for the tiles in it that have been broken
+static uint32_t Breakable_rows(const uint8_t x)
+{
+  uint32_t rows = 0;
+  for (uint8_t i = 0; i < brokenCells; ++i)
+    if (brokenCell.cell[i].x == x)
+      rows |= ((uint32_t)1 << brokenCell.cell[i].y);
+  return rows;
+}
+#endif // BREAKABLE_TILES
+
+/*
+ * StreamColumn
+ *
+ * Decodes, autotiles, and overlays a single world column into the vram
+ * column it maps to, which gives the same tiles LoadLevel would have drawn
+ *
+ * x [in]
+ *   The world column, where columns outside of the level are filled with sky
+ *
+ * Note: This is the only per-frame cost of scrolling, and the camera never
+ *       streams in more than one column per frame. The work is bounded by
+ *       3 * SCREEN_TILES_V bitmap reads, plus one read per coordinate of the
+ *       treasures, oneways, ladders, and fires of the screen x is on (and
+ *       a pass over the tiles that have been broken, which are in RAM). In
+ *       a PROFILE build, the largest number of reads is kept in
+ *       streamCostMax, and every time it grows it is written to the uzem
+ *       whisper port.
+ */
+__attribute__(( optimize("Os") ))
+static void StreamColumn(const uint8_t x)
+{
+  uint16_t offset = vramOffset(x, 0);
+  if (x >= levelTilesH) {
+    for (uint8_t y = 0; y < SCREEN_TILES_V; ++y, offset = vramDown(offset))
+      vram[offset] = FIRST_SKY_TILE + RAM_TILES_COUNT;
+    hudRow[x & (VRAM_TILES_H - 1)] = FIRST_SKY_TILE + RAM_TILES_COUNT;
+    return;
+  }
+
+  // Autotile exactly the way AutotileMap does, except that the neighboring columns come straight from flash
+  uint32_t left = WideMap_column(x - 1);
+  uint32_t column = WideMap_column(x);
+  uint32_t right = WideMap_column(x + 1);
+#if (BREAKABLE_TILES == 1)
+  // Broken tiles are sky in the base map, which also changes how the tiles next to them are autotiled
+  left &= ~Breakable_rows(x - 1);
+  column &= ~Breakable_rows(x);
+  right &= ~Breakable_rows(x + 1);
+#endif // BREAKABLE_TILES
+  for (uint8_t y = 0; y < SCREEN_TILES_V; ++y, offset = vramDown(offset)) {
+    uint8_t t;
+    if (columnBit(column, y)) {
+      t = (y == 0 || columnBit(column, y - 1)) ? FIRST_UNDERGROUND_TILE : FIRST_ABOVEGROUND_TILE;
+    } else if (y == SCREEN_TILES_V - 1 || !columnBit(column, y + 1)) { // holes in the bottom border are always full sky tiles
+      t = FIRST_SKY_TILE;
+    } else {
+      const bool solidLDiag = columnBit(left, y + 1);
+      const bool solidRDiag = columnBit(right, y + 1);
+      if (!solidLDiag && !solidRDiag) // island
+        t = 1 + FIRST_SKY_TILE;
+      else if (!solidLDiag) // clear on the left
+        t = 2 + FIRST_SKY_TILE;
+      else if (solidRDiag) // tiles left, below, and right
+        t = 3 + FIRST_SKY_TILE;
+      else // clear on the right
+        t = 4 + FIRST_SKY_TILE;
+    }
+    vram[offset] = t + RAM_TILES_COUNT;
+  }
+  uint16_t cost = 3 * SCREEN_TILES_V;
+
+  // Overlay whatever crosses this column, in the same order as LoadLevel (the Draw* functions only know about one screen)
+  const uint8_t screen = x / LEVEL_SCREEN_TILES_H;
+  const uint8_t lx = x % LEVEL_SCREEN_TILES_H;
+  const uint16_t levelOffset = screenOffset[screen];
+  const uint8_t* packedCoordinatesStart = &levelData[levelOffset + LEVEL_PACKED_COORDINATES_START];
+  const uint8_t treasures = treasureCount(levelOffset);
+  const uint8_t oneways = onewayCount(levelOffset);
+  const uint8_t ladders = ladderCount(levelOffset);
+  const uint8_t fires = fireCount(levelOffset);
+  cost += 2 * treasures + 3 * (oneways + ladders + fires);
+
+  uint16_t packedOffset = MAX_PLAYERS * 2 + MAX_MONSTERS * 2; // 2 coordinates per player, 2 coordinates per monster
+  for (uint8_t i = 0; i < treasures; ++i, packedOffset += 2) {
+    const uint8_t tx = PgmPacked5Bit_read(packedCoordinatesStart, packedOffset);
+    const uint8_t ty = PgmPacked5Bit_read(packedCoordinatesStart, packedOffset + 1);
+    const uint8_t index = screenTreasureBase[screen] + i;
+    if (tx == lx && ty < SCREEN_TILES_V && !treasureIsTaken(index))
+      vram[vramOffset(x, ty)] -= TREASURE_TO_SKY_OFFSET;
+  }
+  for (uint8_t i = 0; i < oneways; ++i, packedOffset += 3) {
+    const uint8_t y = PgmPacked5Bit_read(packedCoordinatesStart, packedOffset);
+    const uint8_t x1 = PgmPacked5Bit_read(packedCoordinatesStart, packedOffset + 1);
+    const uint8_t x2 = PgmPacked5Bit_read(packedCoordinatesStart, packedOffset + 2);
+    if (y < SCREEN_TILES_V && x1 <= lx && lx <= x2 && x2 < LEVEL_SCREEN_TILES_H) {
+      offset = vramOffset(x, y);
+      const uint8_t t = vramTile(offset);
+      if ((t >= FIRST_ABOVEGROUND_TILE) && (t <= LAST_ABOVEGROUND_TILE) && ((y == SCREEN_TILES_V - 1) || !isSolid(vramTile(vramDown(offset)))))
+        vram[offset] += ABOVEGROUND_TO_ABOVEGROUND_ONE_WAY_OFFSET;
+    }
+  }
+  for (uint8_t i = 0; i < ladders; ++i, packedOffset += 3) {
+    const uint8_t tx = PgmPacked5Bit_read(packedCoordinatesStart, packedOffset);
+    const uint8_t y1 = PgmPacked5Bit_read(packedCoordinatesStart, packedOffset + 1);
+    const uint8_t y2 = PgmPacked5Bit_read(packedCoordinatesStart, packedOffset + 2);
+    if (tx == lx && y1 < SCREEN_TILES_V && y2 < SCREEN_TILES_V) {
+      offset = vramOffset(x, y1);
+      uint8_t t = vramTile(offset);
+      if (t < NELEMS(MapTileToLadderTop))
+        vram[offset] = pgm_read_byte(&MapTileToLadderTop[t]) + RAM_TILES_COUNT;
+      for (uint8_t y = y1; y < y2; ++y) {
+        offset = vramDown(offset);
+        t = vramTile(offset);
+        if (t < NELEMS(MapTileToLadderMiddle))
+          vram[offset] = pgm_read_byte(&MapTileToLadderMiddle[t]) + RAM_TILES_COUNT;
+      }
+    }
+  }
+  for (uint8_t i = 0; i < fires; ++i, packedOffset += 3) {
+    const uint8_t y = PgmPacked5Bit_read(packedCoordinatesStart, packedOffset);
+    const uint8_t x1 = PgmPacked5Bit_read(packedCoordinatesStart, packedOffset + 1);
+    const uint8_t x2 = PgmPacked5Bit_read(packedCoordinatesStart, packedOffset + 2);
+    if (y < SCREEN_TILES_V && x1 <= lx && lx <= x2 && x2 < LEVEL_SCREEN_TILES_H) {
+      offset = vramOffset(x, y);
+      if (vramTile(offset) < FIRST_UNDERGROUND_TILE)
+        vram[offset] = FIRST_FIRE_TILE + RAM_TILES_COUNT;
+    }
+  }
+
+  hudRow[x & (VRAM_TILES_H - 1)] = vram[vramOffset(x, 0)];
+
+#if (PROFILE == 1)
+  if (cost > streamCostMax) {
+    streamCostMax = cost;
+    UZEMHEX = HI8(cost);
+    UZEMHEX = LO8(cost);
+  }
+#else // PROFILE
+  (void)cost;
+#endif // PROFILE
+}
+
+// Points the hardware scroll at cameraX, which is always a whole number of tiles, since the score display scrolls too
+#define Camera_scroll() (Screen.scrollX = (cameraX & (VRAM_TILES_H - 1)) * TILE_WIDTH)
+
+/*
+ * Camera_follow
+ *
+ * Moves the camera at most one column toward centering the entity, and
+ * streams in the column that becomes resident on the side it moved to
+ *
+ * e [in]
+ *   The entity to follow (player 0)
+ *
+ * Returns:
+ *   true if the camera moved, in which case the score display needs to be redrawn
+ */
+static bool Camera_follow(const ENTITY* const e)
+{
+  int16_t target = p2ht(e->x + ht2p(1) / 2) - SCREEN_TILES_H / 2;
+  if (target > levelTilesH - SCREEN_TILES_H)
+    target = levelTilesH - SCREEN_TILES_H;
+  else if (target < 0)
+    target = 0;
+  if (target > cameraX) {
+    ++cameraX;
+    StreamColumn(cameraX + SCREEN_TILES_H);
+  } else if (target < cameraX) {
+    --cameraX;
+    StreamColumn(cameraX - 1);
+  } else {
+    return false;
+  }
+
+  // Put back the tiles that were under the score display, before it is drawn in its new place
+  for (uint8_t x = 0; x < SCREEN_TILES_H + 2; ++x) {
+    const uint8_t column = (cameraX - 1 + x) & (VRAM_TILES_H - 1);
+    vram[column] = hudRow[column];
+  }
+  Camera_scroll();
+  return true;
+}
+
+// Keeps another player inside of the camera, since nothing outside of it is resident in vram
+static void Camera_clamp(ENTITY* const e)
+{
+  if (e->x < ht2p(cameraX)) {
+    e->x = ht2p(cameraX);
+    e->dx = 0;
+  } else if (e->x > ht2p(cameraX + SCREEN_TILES_H - 1)) {
+    e->x = ht2p(cameraX + SCREEN_TILES_H - 1);
+    e->dx = 0;
+  }
+}
+
+// Entities outside of the camera are frozen, since the tiles around them are not resident in vram
+#define Camera_contains(e) ((uint8_t)(p2ht((e)->x) - cameraX) < SCREEN_TILES_H)
+
+/*
+ * WideLevel_load
+ *
+ * Gathers every screen of a wide level, and streams in the columns around
+ * player 0, instead of decoding a single screen into vram
+ *
+ * level [in]
+ *   The first screen of the level
+ *
+ * screens [in]
+ *   How many screens the level spans
+ *
+ * header [in/out]
+ *   The header of the first screen. Monster slot i is taken from screen
+ *   i % screens, so its flags and profile are replaced by that screen's.
+ *
+ * Returns:
+ *   The number of treasures in the whole level
+ */
+__attribute__(( optimize("Os") ))
+static uint8_t WideLevel_load(const uint8_t level, const uint8_t screens, LEVEL_HEADER* const header)
+{
+  BUILD_BUG_ON(isNotPowerOf2(VRAM_TILES_H));
+  BUILD_BUG_ON(VRAM_TILES_H < SCREEN_TILES_H + 2); // the visible columns, plus one on either side
+  BUILD_BUG_ON(LEVEL_MAX_SCREENS * LEVEL_SCREEN_TILES_H > 255);
+
+  levelTilesH = screens * LEVEL_SCREEN_TILES_H;
+  const uint8_t treasures = Level_gatherScreens(level, screens);
+
+  for (uint8_t i = 0; i < MAX_PLAYERS + MAX_MONSTERS; ++i) {
+    const uint8_t s = (i < MAX_PLAYERS) ? 0 : (i - MAX_PLAYERS) % screens;
+    const uint8_t* packedCoordinatesStart = &levelData[screenOffset[s] + LEVEL_PACKED_COORDINATES_START];
+    const uint8_t x = PgmPacked5Bit_read(packedCoordinatesStart, i * 2);
+    wideXY[i][0] = (x < LEVEL_SCREEN_TILES_H) ? x + s * LEVEL_SCREEN_TILES_H : 0xFF;
+    wideXY[i][1] = PgmPacked5Bit_read(packedCoordinatesStart, i * 2 + 1);
+    if (i >= MAX_PLAYERS) {
+      header->monsterFlags[i - MAX_PLAYERS] = pgm_read_byte(&levelData[screenOffset[s] + LEVEL_MONSTER_INITIAL_FLAGS_START + i - MAX_PLAYERS]);
+      header->monsterProfile[i - MAX_PLAYERS] = pgm_read_byte(&levelData[screenOffset[s] + LEVEL_MONSTER_PROFILE_START + i - MAX_PLAYERS]);
+    }
+  }
+
+  // Start with player 0 as close to the middle of the screen as the edges of the level allow
+  int16_t camera = (int16_t)wideXY[0][0] - SCREEN_TILES_H / 2;
+  if (camera > levelTilesH - SCREEN_TILES_H)
+    camera = levelTilesH - SCREEN_TILES_H;
+  cameraX = (camera < 0) ? 0 : camera;
+  for (uint8_t x = 0; x < SCREEN_TILES_H + 2; ++x)
+    StreamColumn(cameraX - 1 + x);
+  Camera_scroll();
+
+  return treasures;
+}
+#endif // WIDE_LEVELS
+
+#if (ROOM_LEVELS == 1)
+#if (LEVEL_PACK == 1)
+#error ROOM_LEVELS reads every room of a level out of the built-in level data, so LEVEL_PACK must be 0
+#endif
+static uint8_t currentRoom;                           // index of the room being shown, into screenOffset
+static uint8_t roomColumns = 1;                       // how many rooms wide the grid of rooms is
+static uint8_t roomMonstersKilled[LEVEL_MAX_SCREENS]; // one bit per monster slot, for monsters that stay dead when their room is entered again
+
+// Only levels with more than one room keep track of collected treasure, which also leaves generated levels alone
+#define collectTreasure(offset, tx, ty) do { vram[(offset)] += TREASURE_TO_SKY_OFFSET; \
+    if (levelSpan > 1) Level_takeTreasure(currentRoom, (tx), (ty)); } while (0)
+#define roomTreasureTaken(i) ((levelSpan > 1) && treasureIsTaken(screenTreasureBase[currentRoom] + (i)))
+
+// Returns the ROOM_EDGE_* bits of the edges of the current room that lead to a neighboring room
+__attribute__(( optimize("Os") ))
+static uint8_t Room_exits(void)
+{
+  const uint8_t column = currentRoom % roomColumns;
+  uint8_t exits = 0;
+  if (column != 0)
+    exits |= ROOM_EDGE_LEFT;
+  if ((column != roomColumns - 1) && (currentRoom + 1 < levelSpan))
+    exits |= ROOM_EDGE_RIGHT;
+  if (currentRoom >= roomColumns)
+    exits |= ROOM_EDGE_UP;
+  if (currentRoom + roomColumns < levelSpan)
+    exits |= ROOM_EDGE_DOWN;
+  return exits;
+}
+#else // ROOM_LEVELS
+#define roomTreasureTaken(i) false
+#if (WIDE_LEVELS == 0)
+#define collectTreasure(offset, tx, ty) (vram[(offset)] += TREASURE_TO_SKY_OFFSET)
+#endif // WIDE_LEVELS
+#endif // ROOM_LEVELS
+
+#if (BREAKABLE_TILES == 1)
+#if (ROOM_LEVELS == 1)
+#define breakableScreen currentRoom
+#else // ROOM_LEVELS
+#define breakableScreen 0
+#endif // ROOM_LEVELS
+
+#if (WIDE_LEVELS == 1)
+// Only the visible columns, and one on either side, are resident in vram
+#define Breakable_resident(x) (((x) < levelTilesH) && ((uint8_t)((x) - cameraX + 1) < SCREEN_TILES_H + 2))
+#else // WIDE_LEVELS
+#define Breakable_resident(x) ((x) < SCREEN_TILES_H)
+#endif // WIDE_LEVELS
+
+#define Breakable_reset() (breakableRuns = brokenCells = crumblingCells = 0)
+
+/*
+ * Breakable_load
+ *
+ * Forgets every tile that was broken, and copies the runs of breakable
+ * tiles of a level into RAM
+ *
+ * level [in]
+ *   The first screen (or room) of the level
+ *
+ * screens [in]
+ *   How many screens (or rooms) the level spans
+ *
+ * Note: Restarting a level loads it again, which draws every tile from
+ *       the level data, so putting back the tiles that were broken only
+ *       takes resetting the counts.
+ */
+__attribute__(( optimize("Os") ))
+static void Breakable_load(const uint8_t level, const uint8_t screens)
+{
+  Breakable_reset();
+  for (const uint8_t* p = breakableData; pgm_read_byte(p) != 0xFF; p += 4) {
+    const uint8_t screen = pgm_read_byte(p) - level;
+    const uint8_t y = pgm_read_byte(p + 1);
+    if (screen >= screens || (y & BREAKABLE_Y_MASK) < 2 || (y & BREAKABLE_Y_MASK) >= SCREEN_TILES_V || breakableRuns == BREAKABLE_MAX_RUNS)
+      continue;
+    BREAKABLE_RUN* const r = &breakableRun[breakableRuns++];
+    r->y = y;
+#if (WIDE_LEVELS == 1)
+    r->screen = 0;
+    r->x1 = pgm_read_byte(p + 2) + screen * LEVEL_SCREEN_TILES_H;
+    r->x2 = pgm_read_byte(p + 3) + screen * LEVEL_SCREEN_TILES_H;
+#else // WIDE_LEVELS
+    r->screen = screen;
+    r->x1 = pgm_read_byte(p + 2);
+    r->x2 = pgm_read_byte(p + 3);
+#endif // WIDE_LEVELS
+  }
+}
+
+// Returns the BREAKABLE_* class of the tile at (x, y), or 0 if it does not break
+static uint8_t Breakable_class(const uint8_t x, const uint8_t y)
+{
+  for (uint8_t i = 0; i < breakableRuns; ++i) {
+    const BREAKABLE_RUN* const r = &breakableRun[i];
+    if (r->screen == breakableScreen && (r->y & BREAKABLE_Y_MASK) == y && r->x1 <= x && x <= r->x2)
+      return r->y & ~BREAKABLE_Y_MASK;
+  }
+  return 0;
+}
+
+// Returns true if the tile at (x, y) is solid in the base map, where everything outside of the level is solid
+static bool Breakable_mapSolid(const uint8_t x, const uint8_t y)
+{
+#if (WIDE_LEVELS == 1)
+  if (x >= levelTilesH)
+    return true;
+  if (!Breakable_resident(x))
+    return columnBit(WideMap_column(x) & ~Breakable_rows(x), y);
+#else // WIDE_LEVELS
+  if (x >= SCREEN_TILES_H)
+    return true;
+#endif // WIDE_LEVELS
+  const uint8_t t = vramTile(vramOffset(x, y));
+  return isSolid(t) || ((t >= FIRST_ABOVEGROUND_ONE_WAY_TILE) && (t <= LAST_ABOVEGROUND_ONE_WAY_LADDER_TOP_TILE));
+}
+
+/*
+ * Breakable_autotile
+ *
+ * Autotiles a single resident tile again, after the base map around it
+ * has changed, the same way AutotileMap would have
+ *
+ * x [in]
+ *   The column of the tile, which is skipped if it is not resident
+ *
+ * y [in]
+ *   The row of the tile, which must not be the top row
+ *
+ * Note: Treasure, and the ladders that cross the sky, keep whatever is
+ *       overlaid on them, since they follow the same order as the sky
+ *       tiles. Tiles that have nothing to do with the sky or the ground
+ *       are left alone.
+ */
+__attribute__(( optimize("Os") ))
+static void Breakable_autotile(const uint8_t x, const uint8_t y)
+{
+  if (!Breakable_resident(x) || y >= SCREEN_TILES_V)
+    return;
+
+  const uint16_t offset = vramOffset(x, y);
+  const uint8_t t = vramTile(offset);
+  if (t == FIRST_UNDERGROUND_TILE) {
+    if (!Breakable_mapSolid(x, y - 1))
+      vram[offset] = FIRST_ABOVEGROUND_TILE + RAM_TILES_COUNT;
+    return;
+  }
+
+  uint8_t first;
+  if (t <= LAST_TREASURE_TILE)
+    first = FIRST_TREASURE_TILE;
+  else if ((t >= FIRST_SKY_TILE) && (t <= LAST_SKY_TILE))
+    first = FIRST_SKY_TILE;
+  else if ((t >= FIRST_SKY_LADDER_TOP_TILE) && (t <= LAST_SKY_LADDER_TOP_TILE))
+    first = FIRST_SKY_LADDER_TOP_TILE;
+  else if ((t >= FIRST_SKY_LADDER_MIDDLE_TILE) && (t <= LAST_SKY_LADDER_MIDDLE_TILE))
+    first = FIRST_SKY_LADDER_MIDDLE_TILE;
+  else
+    return;
+
+  uint8_t variant = 0; // clear all around
+  if ((y != SCREEN_TILES_V - 1) && Breakable_mapSolid(x, y + 1)) {
+    const bool solidLDiag = Breakable_mapSolid(x - 1, y + 1);
+    const bool solidRDiag = Breakable_mapSolid(x + 1, y + 1);
+    if (!solidLDiag && !solidRDiag) // island
+      variant = 1;
+    else if (!solidLDiag) // clear on the left
+      variant = 2;
+    else if (solidRDiag) // tiles left, below, and right
+      variant = 3;
+    else // clear on the right
+      variant = 4;
+  }
+  vram[offset] = first + variant + RAM_TILES_COUNT;
+}
+
+/*
+ * Breakable_break
+ *
+ * Turns a resident tile into sky, and autotiles the tiles whose look
+ * depends on it again
+ *
+ * x [in]
+ *   The column of the tile
+ *
+ * y [in]
+ *   The row of the tile, which must not be one of the top two rows
+ *
+ * Note: A tile is only broken if it can be remembered, so vram never
+ *       holds a change that drawing the level again would lose. The
+ *       tile below, the tile above, and the tiles diagonally above are
+ *       the only ones AutotileMap looks at this tile for.
+ */
+__attribute__(( optimize("Os") ))
+static void Breakable_break(const uint8_t x, const uint8_t y)
+{
+  if (brokenCells == BREAKABLE_MAX_BROKEN)
+    return;
+  BREAKABLE_CELL* const c = &brokenCell.cell[brokenCells++];
+  c->screen = breakableScreen;
+  c->x = x;
+  c->y = y;
+
+  if (Breakable_resident(x))
+    vram[vramOffset(x, y)] = FIRST_SKY_TILE + RAM_TILES_COUNT;
+  Breakable_autotile(x, y);
+  Breakable_autotile(x, y + 1);
+  Breakable_autotile(x - 1, y - 1);
+  Breakable_autotile(x, y - 1);
+  Breakable_autotile(x + 1, y - 1);
+  TriggerFx(3, 128, true);
+}
+
+// Returns true if the tile at (x, y) is a solid tile of the given class that can still break
+static bool Breakable_canBreak(const uint8_t x, const uint8_t y, const uint8_t breakableClass)
+{
+  if (!Breakable_resident(x) || !(Breakable_class(x, y) & breakableClass))
+    return false;
+  const uint8_t t = vramTile(vramOffset(x, y));
+  return Breakable_mapSolid(x, y) && !isLadder(t);
+}
+
+/*
+ * Breakable_touch
+ *
+ * Starts crumbling the crumbling tiles a player is standing on, and
+ * breaks the tiles a player has just jumped into from below
+ *
+ * e [in]
+ *   The player, after its update function has run
+ *
+ * prevDY [in]
+ *   The vertical velocity of the player before its update function ran
+ */
+__attribute__(( optimize("Os") ))
+static void Breakable_touch(const ENTITY* const e, const int16_t prevDY)
+{
+  if (!e->interacts || e->dead || e->update != player_update || nv(e->y))
+    return;
+
+  const uint8_t tx = p2ht(e->x);
+  const uint8_t ty = p2vt(e->y);
+  const uint8_t width = nh(e->x) ? 2 : 1;
+  if (!e->falling && !e->jumping && ty + 1 < SCREEN_TILES_V) {
+    for (uint8_t x = tx; x < tx + width; ++x) {
+      if (!Breakable_canBreak(x, ty + 1, BREAKABLE_CRUMBLE) || crumblingCells == BREAKABLE_MAX_CRUMBLING)
+        continue;
+      bool crumbling = false;
+      for (uint8_t i = 0; i < crumblingCells; ++i)
+        if (crumblingCell[i].x == x && crumblingCell[i].y == ty + 1)
+          crumbling = true;
+      if (crumbling)
+        continue;
+      BREAKABLE_CELL* const c = &crumblingCell[crumblingCells];
+      c->screen = breakableScreen;
+      c->x = x;
+      c->y = ty + 1;
+      crumblingFrames[crumblingCells++] = BREAKABLE_CRUMBLE_FRAMES;
+
+      // Ground that starts to crumble thins out into a one way tile, which still holds the player up
+      const uint16_t offset = vramOffset(x, ty + 1);
+      if (vram[offset] == FIRST_ABOVEGROUND_TILE + RAM_TILES_COUNT)
+        vram[offset] += ABOVEGROUND_TO_ABOVEGROUND_ONE_WAY_OFFSET;
+    }
+  } else if (prevDY + WORLD_GRAVITY / WORLD_FPS < 0 && e->dy == 0 && ty > 0) { // gravity alone would have kept the player rising
+    // Only a solid tile stops the head of a player, where the top of an ordinary jump would not
+    bool bumped = false;
+    for (uint8_t x = tx; x < tx + width; ++x)
+      bumped |= isSolid(vramTile(vramOffset(x, ty - 1)));
+    if (!bumped)
+      return;
+    for (uint8_t x = tx; x < tx + width; ++x)
+      if (Breakable_canBreak(x, ty - 1, BREAKABLE_BUMP))
+        Breakable_break(x, ty - 1);
+  }
+}
+
+// Breaks the crumbling tiles whose time is up, or all of them if now is true
+__attribute__(( optimize("Os") ))
+static void Breakable_crumble(const bool now)
+{
+  for (uint8_t i = 0; i < crumblingCells; ) {
+    if (now || --crumblingFrames[i] == 0) {
+      Breakable_break(crumblingCell[i].x, crumblingCell[i].y);
+      --crumblingCells;
+      crumblingCell[i] = crumblingCell[crumblingCells];
+      crumblingFrames[i] = crumblingFrames[crumblingCells];
+    } else {
+      ++i;
+    }
+  }
+}
+
+// Turns the tiles of the current screen (or room) that have been broken into sky in the base map, before it is autotiled
+static void Breakable_clearMap(void)
+{
+  for (uint8_t i = 0; i < brokenCells; ++i)
+    if (brokenCell.cell[i].screen == breakableScreen)
+      vram[vramOffset(brokenCell.cell[i].x, brokenCell.cell[i].y)] = FIRST_SKY_TILE + RAM_TILES_COUNT;
+}
+#endif // BREAKABLE_TILES
+
+__attribute__(( always_inline ))
+static inline void entityInitialXY(const uint16_t levelOffset, const uint8_t i, uint8_t* const x, uint8_t* const y)
+{
+#if (LEVEL_GENERATOR == 1)
+  if (levelOffset == GENERATED_LEVEL_OFFSET) {
+    if (i < MAX_PLAYERS) {
+      *x = generatedPlayerX(i);
+      *y = generatedPlayerY(i);
+    } else {
+      *x = generatedXY[i - MAX_PLAYERS][0];
+      *y = generatedXY[i - MAX_PLAYERS][1];
+    }
+    return;
+  }
+#endif // LEVEL_GENERATOR
+#if (WIDE_LEVELS == 1)
+  (void)levelOffset;
+  *x = wideXY[i][0];
+  *y = wideXY[i][1];
+  return;
+#endif // WIDE_LEVELS
+  const uint8_t* packedCoordinatesStart = &levelBytes[levelOffset + LEVEL_PACKED_COORDINATES_START];
+  *x = PgmPacked5Bit_read(packedCoordinatesStart, i * 2);
+  *y = PgmPacked5Bit_read(packedCoordinatesStart, i * 2 + 1);
+}
+
+// Decodes the base map of the level at levelOffset into vram, autotiles it, and overlays its treasures (unless
+// they have already been collected), oneways, ladders, and fires
+__attribute__(( optimize("Os") ))
+static void DrawLevel(const uint16_t levelOffset)
+{
+  // Read the number of treasures, oneways, ladders, and fires, which are needed to locate a compressed map
+  const uint8_t* packedCoordinatesStart = &levelBytes[levelOffset + LEVEL_PACKED_COORDINATES_START];
+  const uint8_t treasures = treasureCount(levelOffset);
+  const uint8_t oneways = onewayCount(levelOffset);
+  const uint8_t ladders = ladderCount(levelOffset);
+  const uint8_t fires = fireCount(levelOffset);
+
+#if (LEVEL_MAP_COMPRESSED == 1)
+  const uint16_t packedCoordinates = MAX_PLAYERS * 2 + MAX_MONSTERS * 2 + treasures * 2 + (oneways + ladders + fires) * 3;
+  DecodeMap(packedCoordinatesStart + ((packedCoordinates * 5 + 7) >> 3)); // 5 bits packed into 8
+#else // LEVEL_MAP_COMPRESSED
+  DecodeMap(&levelBytes[levelOffset + LEVEL_MAP_START]);
+#endif // LEVEL_MAP_COMPRESSED
+
+#if (BREAKABLE_TILES == 1)
+  Breakable_clearMap();
+#endif // BREAKABLE_TILES
+  AutotileMap();
+
+  // Overlay treasures, oneways, ladders, and fires
+  uint16_t packedOffset = MAX_PLAYERS * 2 + MAX_MONSTERS * 2; // 2 coordinates per player, 2 coordinates per monster
+  for (uint8_t i = 0; i < treasures; ++i) {
+    const uint8_t x = PgmPacked5Bit_read(packedCoordinatesStart, packedOffset + i * 2);
+    const uint8_t y = PgmPacked5Bit_read(packedCoordinatesStart, packedOffset + i * 2 + 1);
+    if (!roomTreasureTaken(i))
+      DrawTreasure(x, y);
+  }
+  packedOffset += treasures * 2; // 2 coordinates per treasure
+  for (uint8_t i = 0; i < oneways; ++i) {
+    const uint8_t y = PgmPacked5Bit_read(packedCoordinatesStart, packedOffset + i * 3);
+    const uint8_t x1 = PgmPacked5Bit_read(packedCoordinatesStart, packedOffset + i * 3 + 1);
+    const uint8_t x2 = PgmPacked5Bit_read(packedCoordinatesStart, packedOffset + i * 3 + 2);
+    DrawOneWay(y, x1, x2);
+  }
+  packedOffset += oneways * 3; // 3 coordinates per oneway
+  for (uint8_t i = 0; i < ladders; ++i) {
+    const uint8_t x = PgmPacked5Bit_read(packedCoordinatesStart, packedOffset + i * 3);
+    const uint8_t y1 = PgmPacked5Bit_read(packedCoordinatesStart, packedOffset + i * 3 + 1);
+    const uint8_t y2 = PgmPacked5Bit_read(packedCoordinatesStart, packedOffset + i * 3 + 2);
+    DrawLadder(x, y1, y2);
+  }
+  packedOffset += ladders * 3; // 3 coordinates per ladder
+  for (uint8_t i = 0; i < fires; ++i) {
+    const uint8_t y = PgmPacked5Bit_read(packedCoordinatesStart, packedOffset + i * 3);
+    const uint8_t x1 = PgmPacked5Bit_read(packedCoordinatesStart, packedOffset + i * 3 + 1);
+    const uint8_t x2 = PgmPacked5Bit_read(packedCoordinatesStart, packedOffset + i * 3 + 2);
+    DrawFire(y, x1, x2);
+  }
+}
+
+// Returns offset into levelBytes (the levelData PROGMEM array, or levelCache when LEVEL_PACK is 1)
+__attribute__(( optimize("Os") ))
+static uint16_t LoadLevel(const uint8_t level, LEVEL_HEADER* const header, uint8_t* const treasures, uint16_t* const timeBonus)
+{
+  // Bounds check level
+  if (level >= numLevels())
+    return 0xFFFF; // bogus value
+
+#if (LEVEL_PACK == 1)
+  // Copy the whole level into RAM while the screen is faded out, so nothing during gameplay touches the SD card
+  if (!LevelCache_fill(level))
+    return 0xFFFF; // bogus value
+  const uint16_t levelOffset = 0;
+#else // LEVEL_PACK
+  // Determine the offset into the PROGMEM array where the level data begins
+  const uint16_t levelOffset = levelOffset(level);
+#endif // LEVEL_PACK
+
+  // Compile-time assert that the RAM header matches the PROGMEM layout
+  BUILD_BUG_ON(sizeof(LEVEL_HEADER) != LEVEL_MONSTER_PROFILE_START + LEVEL_MONSTER_PROFILE_SIZE);
+  BUILD_BUG_ON(MONSTER_PROFILES_N > 256); // profiles are referenced by a uint8_t index
+
+  // Copy the entire fixed-size header into RAM with a single read, then read the theme, and draw the base map
+  levelRead(header, &levelBytes[levelOffset], sizeof(LEVEL_HEADER));
+#if (BREAKABLE_TILES == 1)
+  Breakable_load(level, levelScreens(header->theme));
+#endif // BREAKABLE_TILES
+#if (WIDE_LEVELS == 1) || (ROOM_LEVELS == 1)
+  BUILD_BUG_ON(THEMES_N > LEVEL_THEME_MASK + 1);
+  const uint8_t screens = levelScreens(header->theme);
+  if ((header->theme & LEVEL_CONTINUED) || (screens > LEVEL_MAX_SCREENS) || (level + screens > numLevels()))
+    return 0xFFFF; // bogus value
+#if (ROOM_LEVELS == 1)
+  roomColumns = levelRoomColumns(header->theme);
+#endif // ROOM_LEVELS
+  header->theme &= LEVEL_THEME_MASK;
+#endif // WIDE_LEVELS || ROOM_LEVELS
+  if (header->theme >= THEMES_N) // something major went wrong
+    return 0xFFFF; // bogus value
+
+  SetTileTable(tileset + (TILE_WIDTH * TILE_HEIGHT) * ((TILESET_SIZE - TITLE_SCREEN_TILES) / (THEMES_N)) * header->theme);
+
+  *timeBonus = header->timeBonus + 1;
+  if (*timeBonus > 999)
+    *timeBonus = 999;
+
+#if (WIDE_LEVELS == 1)
+  *treasures = WideLevel_load(level, screens, header);
+  return levelOffset;
+#endif // WIDE_LEVELS
+
+#if (ROOM_LEVELS == 1)
+  // Start in the first room, with every room's treasures and monsters where the level data puts them
+  *treasures = Level_gatherScreens(level, screens);
+  currentRoom = 0;
+  memset(roomMonstersKilled, 0, sizeof(roomMonstersKilled));
+  roomExits = Room_exits();
+#else // ROOM_LEVELS
+  *treasures = treasureCount(levelOffset);
+#endif // ROOM_LEVELS
+  DrawLevel(levelOffset);
+
+  return levelOffset;
+}
+
+#if (LEVEL_GENERATOR == 1)
+// Generated levels are built from horizontal tiers of platforms, stacked from the ground up. No gap in a tier is
+// wider than GENERATOR_MAX_GAP, which can always be jumped, and each tier has a ladder down to the tier below it,
+// so anywhere a player can stand on a tier is reachable. Treasure is only placed where a player can stand.
+#define GENERATOR_TOP_TIER_ROW 6 // leaves room above the highest tier for treasure, and the score display
+#define GENERATOR_MAX_TIERS 5
+#define GENERATOR_MAX_GAP 2
+#define GENERATOR_LADDERS_PER_TIER 2
+#define GENERATOR_MAX_TREASURES 24
+#define GENERATOR_MAX_FIRES 4
+
+// Monsters that stay on the platform they spawn on, and monsters that sweep across the level
+const uint8_t generatorWalkers[] PROGMEM = { MP_LADYBUG_0, MP_ANT_3, MP_ANT_5, MP_ANT_6, MP_CRICKET_2 };
+const uint8_t generatorFlyers[] PROGMEM = { MP_BEE_9, MP_BEE_10, MP_FRUITFLY_3, MP_FRUITFLY_4, MP_FRUITFLY_5, MP_BUTTERFLY_0, MP_BUTTERFLY_9 };
+
+// 16-bit xorshift, which never returns 0 when given a non-zero value
+__attribute__(( optimize("Os") ))
+static uint16_t Generator_next(uint16_t x)
+{
+  x ^= x << 7;
+  x ^= x >> 9;
+  x ^= x << 8;
+  return x;
+}
+
+// Returns a random number in [0, n), and advances the generator state
+__attribute__(( optimize("Os") ))
+static uint8_t Generator_range(uint16_t* const state, const uint8_t n)
+{
+  *state = Generator_next(*state);
+  return (uint8_t)(*state >> 8) % n;
+}
+
+#define GeneratorIsSky(t) (((t) >= FIRST_SKY_TILE) && ((t) <= LAST_SKY_TILE))
+#define GeneratorIsFloor(t) (isSolid(t) || isOneWay(t))
+
+/*
+ * GenerateLevel
+ *
+ * Builds a level from a seed, producing the same things LoadLevel does,
+ * so the rest of the game can't tell the difference
+ *
+ * seed [in]
+ *   The seed, the same seed always produces the same level
+ *
+ * difficulty [in]
+ *   How many levels have been cleared, more monsters, treasure, and fire
+ *   are added as it increases
+ *
+ * header [out]
+ *   The level header
+ *
+ * treasures [out]
+ *   The number of treasures
+ *
+ * timeBonus [out]
+ *   The starting time bonus
+ *
+ * Returns:
+ *   GENERATED_LEVEL_OFFSET, which is passed anywhere a levelOffset is
+ *   expected.
+ *
+ *   Note: The base map is built directly in vram, the initial positions
+ *         of the monsters share a union with brokenCell when there is
+ *         one, and every other working variable is on the stack, so this
+ *         uses no more RAM than a loaded level does.
+ */
+__attribute__(( optimize("Os") ))
+static uint16_t GenerateLevel(const uint16_t seed, const uint8_t difficulty, LEVEL_HEADER* const header, uint8_t* const treasures, uint16_t* const timeBonus)
+{
+  uint16_t r = seed ? seed : 1;
+
+  memset(header, 0, sizeof(LEVEL_HEADER));
+  header->theme = Generator_range(&r, THEMES_N);
+#if (BREAKABLE_TILES == 1)
+  Breakable_reset();
+#endif // BREAKABLE_TILES
+  for (uint8_t i = 0; i < MAX_PLAYERS; ++i) {
+    header->playerInput[i] = PLAYER_INPUT;
+    header->playerUpdate[i] = ENTITY_UPDATE;
+    header->playerRender[i] = PLAYER_RENDER;
+  }
+  SetTileTable(tileset + (TILE_WIDTH * TILE_HEIGHT) * ((TILESET_SIZE - TITLE_SCREEN_TILES) / (THEMES_N)) * header->theme);
+
+  // Choose the rows of the tiers, the ground is tier 0
+  uint8_t tierRow[GENERATOR_MAX_TIERS];
+  uint8_t tiers = 0;
+  uint8_t row = SCREEN_TILES_V - 1;
+  tierRow[tiers++] = row;
+  while (tiers < GENERATOR_MAX_TIERS && row >= GENERATOR_TOP_TIER_ROW + 6) {
+    row -= 5 + Generator_range(&r, 2); // leaves enough headroom to jump any gap
+    tierRow[tiers++] = row;
+  }
+
+  // Draw the solid/sky markers of the base map: the walls and the ground, then the platforms of each tier
+  for (uint16_t offset = 0; offset < SCREEN_TILES_H * SCREEN_TILES_V; ++offset) {
+    const uint8_t x = offset % SCREEN_TILES_H;
+    const bool solid = (x == 0 || x == SCREEN_TILES_H - 1 || offset >= (SCREEN_TILES_V - 1) * SCREEN_TILES_H);
+    vram[offset] = (solid ? FIRST_UNDERGROUND_TILE : FIRST_SKY_TILE) + RAM_TILES_COUNT;
+  }
+  for (uint8_t k = 1; k < tiers; ++k) {
+    for (uint8_t x = 1; x < SCREEN_TILES_H - 1; ) {
+      for (uint8_t length = 3 + Generator_range(&r, 6); length && x < SCREEN_TILES_H - 1; --length, ++x)
+        vram[tierRow[k] * SCREEN_TILES_H + x] = FIRST_UNDERGROUND_TILE + RAM_TILES_COUNT;
+      x += Generator_range(&r, GENERATOR_MAX_GAP + 1);
+    }
+  }
+
+  // Choose where the ladders go, and make sure there is a platform at both ends of each one
+  uint8_t ladderX[GENERATOR_MAX_TIERS][GENERATOR_LADDERS_PER_TIER];
+  for (uint8_t k = 1; k < tiers; ++k) {
+    for (uint8_t j = 0; j < GENERATOR_LADDERS_PER_TIER; ++j) {
+      uint8_t x = 0;
+      if (j == 0 || Generator_range(&r, 2)) {
+        x = 2 + Generator_range(&r, SCREEN_TILES_H - 4);
+        vram[tierRow[k] * SCREEN_TILES_H + x] = FIRST_UNDERGROUND_TILE + RAM_TILES_COUNT;
+        vram[tierRow[k - 1] * SCREEN_TILES_H + x] = FIRST_UNDERGROUND_TILE + RAM_TILES_COUNT;
+      }
+      ladderX[k][j] = x;
+    }
+  }
+
+  AutotileMap();
+
+  // Overlay oneways and ladders, which is done before the treasure so treasure never ends up inside a ladder
+  for (uint8_t k = 1; k < tiers; ++k) {
+    if (Generator_range(&r, 3) == 0) {
+      const uint8_t x1 = 1 + Generator_range(&r, SCREEN_TILES_H / 2);
+      DrawOneWay(tierRow[k], x1, x1 + Generator_range(&r, SCREEN_TILES_H / 2));
+    }
+  }
+  for (uint8_t k = 1; k < tiers; ++k)
+    for (uint8_t j = 0; j < GENERATOR_LADDERS_PER_TIER; ++j)
+      if (ladderX[k][j])
+        DrawLadder(ladderX[k][j], tierRow[k], tierRow[k - 1] - 1);
+
+  // Place treasure on open sky tiles directly above a floor
+  uint8_t wanted = 8 + difficulty / 2;
+  if (wanted > GENERATOR_MAX_TREASURES)
+    wanted = GENERATOR_MAX_TREASURES;
+  *treasures = 0;
+  for (uint8_t attempts = wanted * 8; attempts && *treasures < wanted; --attempts) {
+    const uint8_t x = 1 + Generator_range(&r, SCREEN_TILES_H - 2);
+    const uint8_t y = tierRow[Generator_range(&r, tiers)] - 1;
+    if (GeneratorIsSky(GetTile(x, y)) && GeneratorIsFloor(GetTile(x, y + 1)) &&
+        (y != SCREEN_TILES_V - 2 || (x > 2 && x < SCREEN_TILES_H - 3))) { // not where the players start, or where the exit appears
+      DrawTreasure(x, y);
+      ++*treasures;
+    }
+  }
+  // Every level needs at least one treasure, so fall back to the ground, which only ever has ladders on it
+  for (uint8_t x = SCREEN_TILES_H - 2; x > 0 && *treasures == 0; --x) {
+    if (GeneratorIsSky(GetTile(x, SCREEN_TILES_V - 2))) {
+      DrawTreasure(x, SCREEN_TILES_V - 2);
+      ++*treasures;
+    }
+  }
+
+  // Fire only fills the gaps in a tier, so it never covers a floor, treasure, or ladder
+  uint8_t fires = difficulty / 3;
+  if (fires > GENERATOR_MAX_FIRES)
+    fires = GENERATOR_MAX_FIRES;
+  while (fires--) {
+    const uint8_t x1 = 1 + Generator_range(&r, SCREEN_TILES_H - 2);
+    const uint8_t x2 = x1 + Generator_range(&r, SCREEN_TILES_H - 1 - x1);
+    DrawFire(tierRow[1 + Generator_range(&r, tiers - 1)], x1, x2);
+  }
+
+  // The monsters start above the ground, so they never start on a player
+  uint8_t monsters = 2 + difficulty / 2;
+  for (uint8_t i = 0; i < MAX_MONSTERS; ++i) {
+    uint8_t x = 0xFF; // off screen, so spawnMonster leaves the slot empty
+    uint8_t y = 0xFF;
+    const uint8_t k = 1 + Generator_range(&r, tiers - 1);
+    if (i >= monsters) {
+      // Leave the slot empty
+    } else if (i & 1) {
+      header->monsterProfile[i] = pgm_read_byte(&generatorFlyers[Generator_range(&r, NELEMS(generatorFlyers))]);
+      x = 2 + Generator_range(&r, SCREEN_TILES_H - 4);
+      y = tierRow[k] - 2;
+    } else {
+      header->monsterProfile[i] = pgm_read_byte(&generatorWalkers[Generator_range(&r, NELEMS(generatorWalkers))]);
+      for (uint8_t attempts = 8; attempts; --attempts) {
+        const uint8_t tx = 1 + Generator_range(&r, SCREEN_TILES_H - 2);
+        if (!isSolid(GetTile(tx, tierRow[k] - 1)) && isSolid(GetTile(tx, tierRow[k]))) {
+          x = tx;
+          y = tierRow[k] - 1;
+          break;
+        }
+      }
+    }
+    header->monsterFlags[i] = (Generator_range(&r, 2) ? IFLAG_LEFT : IFLAG_RIGHT) | ((difficulty > 10) ? IFLAG_AUTORESPAWN : 0);
+    generatedXY[i][0] = x;
+    generatedXY[i][1] = y;
+  }
+
+  header->timeBonus = 150 + *treasures * 10;
+  *timeBonus = header->timeBonus + 1;
+
+  return GENERATED_LEVEL_OFFSET;
+}
+#endif // LEVEL_GENERATOR
+
+// How many frames to wait between animating treasure
+#define BACKGROUND_FRAME_SKIP 8
+// Defines the order in which the tileset "rows" are swapped in for animating tiles
+const uint8_t backgroundAnimation[] PROGMEM = { 0, 1, 2, 1 };
+
+// The housekeeping in the main loop that does not have to happen on one particular frame, in the order it runs when several are due
+enum TASK;
+typedef enum TASK TASK;
+
+enum TASK {
+  TASK_BACKGROUND, // animate the background tiles
+  TASK_TIMER,      // count down and draw the time bonus
+  TASK_SCORE,      // draw the scores, after any of them changes
+  TASKS_N
+};
+
+// Most cycles to spend on tasks each frame. A task that would go over waits for the next frame, though the first one due always runs.
+#ifndef TASK_BUDGET_CYCLES
+#define TASK_BUDGET_CYCLES 800
+#endif // TASK_BUDGET_CYCLES
+
+#define TASK_BACKGROUND_CYCLES 100     // rough cost of each task, which a PROFILE build measures
+#define TASK_TIMER_CYCLES 600
+#define TASK_SCORE_CYCLES (300 * ((PLAYERS > 1) ? 2 : 1)) // at most two scores are shown at once
+
+typedef struct {
+  uint8_t period; // frames between runs, a power of 2, or 0 for a task that runs once each time it is posted
+  uint8_t offset; // the frame of each period that it comes due on
+  uint16_t cycles;
+} TASK_INFO;
+
+// Indexed by TASK. The timer comes due halfway between background animations, so the two never share a frame.
+const TASK_INFO taskInfo[] PROGMEM = {
+  { BACKGROUND_FRAME_SKIP, 0, TASK_BACKGROUND_CYCLES },
+  { BACKGROUND_FRAME_SKIP, BACKGROUND_FRAME_SKIP / 2, TASK_TIMER_CYCLES },
+  { 0, 0, TASK_SCORE_CYCLES },
+};
+
+static uint8_t taskFrame;
+static uint8_t tasksPending; // one bit per TASK
+
+// Makes a task due on the next frame
+#define Tasks_post(task) (tasksPending |= _BV(task))
+
+// Starts the periods over at the beginning of a level, which needs its scores drawn
+static void Tasks_reset(void)
+{
+  taskFrame = 0;
+  tasksPending = _BV(TASK_SCORE);
+}
+
+/*
+ * Tasks_next
+ *
+ * Marks the periodic tasks that come due this frame, and picks which
+ * of the tasks that are due run, in TASK order, skipping any that
+ * would go over TASK_BUDGET_CYCLES. Those stay due for the next frame.
+ *
+ * Returns:
+ *   One bit per TASK, set for each task that the caller runs this frame
+ */
+static uint8_t Tasks_next(void)
+{
+  BUILD_BUG_ON(NELEMS(taskInfo) != TASKS_N);
+  BUILD_BUG_ON(TASKS_N > 8);
+  uint16_t cycles = 0;
+  uint8_t run = 0;
+  for (uint8_t t = 0; t < TASKS_N; ++t) {
+    const uint8_t period = pgm_read_byte(&taskInfo[t].period);
+    if (period != 0 && (taskFrame & (period - 1)) == pgm_read_byte(&taskInfo[t].offset))
+      tasksPending |= _BV(t);
+    if (!(tasksPending & _BV(t)))
+      continue;
+    const uint16_t cost = pgm_read_word(&taskInfo[t].cycles);
+    if (run != 0 && cycles + cost > TASK_BUDGET_CYCLES)
+      continue;
+    cycles += cost;
+    run |= _BV(t);
+  }
+  tasksPending &= ~run;
+  ++taskFrame;
+  return run;
+}
+
+// Set to 0 to leave out particles, which are drawn in whatever sprite slots are free that frame
+#ifndef PARTICLES
+#define PARTICLES 1
+#endif // PARTICLES
+
+#if (PARTICLES == 1)
+// Most cycles to spend on particles each frame, including both passes over the sprite slots, after which the oldest
+// ones are dropped. A full ring of particles costs more than this, so a burst is thinned out on a busy frame.
+#ifndef PARTICLE_BUDGET_CYCLES
+#define PARTICLE_BUDGET_CYCLES 1000
+#endif // PARTICLE_BUDGET_CYCLES
+
+#define PARTICLE_TILE 78
+#define PARTICLES_N 8         // size of the ring, where a new particle replaces the oldest one
+#define PARTICLE_SHIFT 4      // positions and velocities are in 1/16ths of a pixel, so they integrate without multiplies
+#define PARTICLE_GRAVITY 2    // added to dy every frame
+#define PARTICLE_FRAMES 16
+// What Particles_update charges against the budget, which the most cycles of its PROFILE slot keep honest
+#define PARTICLE_CYCLES 100     // moving one particle and putting it in a sprite slot
+#define PARTICLE_SLOT_CYCLES 16 // looking at one sprite slot, either to give it back or to see if it is free
+
+typedef struct {
+  int16_t x; // world position, so particles scroll along with WIDE_LEVELS
+  int16_t y;
+  int8_t dx;
+  int8_t dy;
+  uint8_t frames; // 0 when the particle is unused
+} PARTICLE;
+
+static PARTICLE particles[PARTICLES_N];
+static uint8_t particleNext; // the oldest particle, which the next one replaces
+
+// Eight directions, about 1.5 pixels per frame, starting up and going clockwise
+const int8_t particleBurst[][2] PROGMEM = {
+  {   0, -24 }, {  17, -17 }, {  24,   0 }, {  17,  17 },
+  {   0,  24 }, { -17,  17 }, { -24,   0 }, { -17, -17 },
+};
+
+#define Particles_reset() memset(particles, 0, sizeof(particles))
+
+/*
+ * Particles_burst
+ *
+ * Emits particles that fly outward from the center of an 8x8 sprite
+ *
+ * x, y [in]
+ *   The top left of the sprite, in the same units as an ENTITY
+ *
+ * count [in]
+ *   How many particles to emit, which should evenly divide the number of
+ *   directions in particleBurst
+ *
+ * Note: When the ring is full, the oldest particles are replaced
+ */
+static void Particles_burst(const int16_t x, const int16_t y, const uint8_t count)
+{
+  BUILD_BUG_ON(isNotPowerOf2(PARTICLES_N));
+  BUILD_BUG_ON(PARTICLE_SHIFT < FP_SHIFT);
+  for (uint8_t i = 0; i < NELEMS(particleBurst); i += NELEMS(particleBurst) / count) {
+    PARTICLE* const p = &particles[particleNext];
+    particleNext = (particleNext + 1) & (PARTICLES_N - 1);
+    p->x = (x + (WORLD_METER / 2)) << (PARTICLE_SHIFT - FP_SHIFT);
+    p->y = (y + (WORLD_METER / 2)) << (PARTICLE_SHIFT - FP_SHIFT);
+    p->dx = (int8_t)pgm_read_byte(&particleBurst[i][0]);
+    p->dy = (int8_t)pgm_read_byte(&particleBurst[i][1]);
+    p->frames = PARTICLE_FRAMES;
+  }
+}
+
+/*
+ * Particles_update
+ *
+ * Moves every particle, and draws each one in a sprite slot that nothing
+ * else is using. Must be called after everything else has been rendered
+ * for the frame.
+ *
+ * player [in]
+ *   The players, whose slots are free while their render is null_render
+ *
+ * monster [in]
+ *   The monsters, whose slots are free while their render is null_render
+ *
+ * exitOpen [in]
+ *   true once the last treasure has been collected, which keeps the slots
+ *   of the exit sign for it even while it is hidden, since the portal
+ *   test reads their position
+ *
+ * Note: Entities that are only hidden, like monsters outside of the
+ *       camera, keep their slots, since they do not set their tile again
+ *       on every frame. Particles are dropped, newest last, once
+ *       PARTICLE_BUDGET_CYCLES have been charged for them and for the
+ *       sprite slots looked at, or when they run out of free slots, so
+ *       the cost of a frame stays bounded.
+ */
+static void Particles_update(const PLAYER* const player, const ENTITY* const monster, const bool exitOpen)
+{
+  BUILD_BUG_ON(PARTICLE_BUDGET_CYCLES < MAX_SPRITES * PARTICLE_SLOT_CYCLES + PARTICLE_CYCLES + PARTICLE_SLOT_CYCLES); // room for one particle
+  for (uint8_t s = 0; s < MAX_SPRITES; ++s)
+    if (sprites[s].tileIndex == PARTICLE_TILE)
+      sprites[s].x = OFF_SCREEN; // give back the slots taken last frame
+
+  uint8_t s = 0;
+  uint16_t budget = PARTICLE_BUDGET_CYCLES - MAX_SPRITES * PARTICLE_SLOT_CYCLES;
+  uint8_t i = particleNext;
+  do {
+    i = (i - 1) & (PARTICLES_N - 1); // newest first, so the oldest are the ones dropped
+    PARTICLE* const p = &particles[i];
+    if (p->frames == 0)
+      continue;
+    --p->frames;
+    p->x += p->dx;
+    p->y += p->dy;
+    p->dy += PARTICLE_GRAVITY;
+    const int16_t x = p->x >> PARTICLE_SHIFT;
+    const int16_t y = p->y >> PARTICLE_SHIFT;
+    const uint8_t screenX = (x < 0 || x > (ENTITY_MAX_X >> FP_SHIFT)) ? OFF_SCREEN : screenPixelX(x << FP_SHIFT);
+    if (budget < PARTICLE_CYCLES + PARTICLE_SLOT_CYCLES || screenX == OFF_SCREEN || y < 0 || y > (ENTITY_MAX_Y >> FP_SHIFT)) {
+      p->frames = 0;
+      continue;
+    }
+    budget -= PARTICLE_CYCLES;
+    bool found = false;
+    for (; s < MAX_SPRITES && budget >= PARTICLE_SLOT_CYCLES; ++s) {
+      budget -= PARTICLE_SLOT_CYCLES;
+      bool parked = true; // projectiles hide their sprite when they despawn
+      if (s < EXIT_SIGN_SPRITE)
+        parked = (((const ENTITY*)&player[s])->render == null_render);
+      else if (s < MONSTER_SPRITE(0))
+        parked = !exitOpen;
+      else if (s < MONSTER_SPRITE(MONSTERS))
+        parked = (monster[s - MONSTER_SPRITE(0)].render == null_render);
+      if (parked && sprites[s].x == OFF_SCREEN) {
+        found = true;
+        break;
+      }
+    }
+    if (!found) {
+      p->frames = 0;
+      continue;
+    }
+    sprites[s].tileIndex = PARTICLE_TILE; // flags are left alone, since the spark is symmetric
+    sprites[s].x = screenX;
+    sprites[s].y = y;
+  } while (i != particleNext);
+}
+#else // PARTICLES
+#define Particles_reset() ((void)0)
+#define Particles_burst(x, y, count) ((void)0)
+#endif // PARTICLES
+
+#if (DEBUG_OVERLAY == 1) || (TRACE == 1) || (PROFILE == 1)
+static volatile uint8_t frameTimerVsyncs; // counted by the post vsync callback
+
+#if (PROFILE == 1)
+static volatile uint16_t frameTimerPhase; // where in its scanline timer 1 was when timer 0 restarted
+
+/*
+ * FrameTimer_phase
+ *
+ * Returns:
+ *   TCNT1, which the kernel runs from 0 to OCR1A once per scanline
+ *
+ * Note: The high byte of TCNT1 comes through a register that the
+ *       kernel's interrupts can also use, so rather than holding them
+ *       off, it reads TCNT1 again until two reads in a row agree. The
+ *       timer counts on between the reads, so they agree when their high
+ *       bytes do, which also retries a read that crossed into the next
+ *       high byte.
+ */
+static uint16_t FrameTimer_phase(void)
+{
+  uint16_t phase = TCNT1;
+  uint16_t again;
+  while (((again = TCNT1) ^ phase) & 0xFF00)
+    phase = again;
+  return phase;
+}
+#endif // PROFILE
+
+// Runs in the vsync interrupt, and restarts timer 0, which the kernel leaves free, at the start of every frame
+static void FrameTimer_vsync(void)
+{
+  TCNT0 = 0;
+  GTCCR = _BV(PSRSYNC); // restart the prescaler too, so each tick is exactly 1024 cycles from here
+  TIFR0 = _BV(TOV0);    // writing a one clears the overflow flag
+#if (PROFILE == 1)
+  frameTimerPhase = FrameTimer_phase();
+#endif // PROFILE
+  ++frameTimerVsyncs;
+}
+
+__attribute__(( optimize("Os") ))
+static void FrameTimer_init(void)
+{
+  TCCR0A = 0;
+  TCCR0B = _BV(CS02) | _BV(CS00); // one tick every 1024 cycles, which is a little over half of a scanline
+  SetUserPostVsyncCallback(&FrameTimer_vsync);
+}
+
+/*
+ * FrameTimer_ticks
+ *
+ * Returns:
+ *   The number of 1024 cycle ticks since the last vsync, using the
+ *   overflow flag as a ninth bit
+ *
+ * Note: The count is read again once the flag is seen, in case the
+ *       timer overflowed between the two reads. A frame that is still
+ *       running after 512 ticks, which is past the next vsync, reads
+ *       as 256 ticks short.
+ */
+static uint16_t FrameTimer_ticks(void)
+{
+  const uint8_t ticks = TCNT0;
+  if (TIFR0 & _BV(TOV0))
+    return TCNT0 + 256;
+  return ticks;
+}
+#endif // (DEBUG_OVERLAY == 1) || (TRACE == 1) || (PROFILE == 1)
+
+#if (PROFILE == 1)
+// Every function that an entity can be given has its own slot, followed by the slots for regions of the main loop
+#define PROFILE_INPUT 0
+#define PROFILE_UPDATE (PROFILE_INPUT + CPU_INPUT + 1)
+#define PROFILE_RENDER (PROFILE_UPDATE + ENTITY_UPDATE_LADDER + 1)
+#define PROFILE_LOAD (PROFILE_RENDER + PLATFORM_RENDER + 1)
+#define PROFILE_HUD (PROFILE_LOAD + 1)
+#define PROFILE_TASK (PROFILE_HUD + 1) // one slot per TASK
+#define PROFILE_SCRIPT (PROFILE_TASK + TASKS_N)
+#define PROFILE_ROOM (PROFILE_SCRIPT + 1)
+#define PROFILE_PLATFORM (PROFILE_ROOM + 1)
+#define PROFILE_PARTICLES (PROFILE_PLATFORM + 1)
+#define PROFILE_SLOTS (PROFILE_PARTICLES + 1)
+#define PROFILE_FRAME_LINES 262 // scanlines between two vsyncs
+
+struct PROFILE_TIME;
+typedef struct PROFILE_TIME PROFILE_TIME;
+
+// A moment, as read from both timers, which is only turned into cycles once the region being measured has ended
+struct PROFILE_TIME {
+  uint8_t vsyncs;
+  uint16_t ticks;
+  uint16_t phase;
+  uint16_t vsyncPhase;
+};
+
+struct PROFILE_STATS;
+typedef struct PROFILE_STATS PROFILE_STATS;
+
+struct PROFILE_STATS {
+  uint16_t calls;
+  uint16_t min;   // saturates at 0xFFFF
+  uint16_t max;   // saturates at 0xFFFF
+  uint32_t total;
+};
+
+static PROFILE_STATS profileStats[PROFILE_SLOTS];
+static uint8_t profileLevel;     // level the cycles were counted on, or 0 for none
+static uint16_t profileScanline; // cycles per scanline
+static uint16_t profileOverhead; // cycles an empty region measures as
+
+static void Profile_now(PROFILE_TIME* const t)
+{
+  do {
+    t->vsyncs = frameTimerVsyncs;
+    t->vsyncPhase = frameTimerPhase;
+    t->phase = FrameTimer_phase();
+    t->ticks = FrameTimer_ticks();
+  } while (t->vsyncs != frameTimerVsyncs);
+}
+
+/*
+ * Profile_sinceVsync
+ *
+ * Combines the two timers into the number of cycles since vsync
+ *
+ * t [in]
+ *   The moment to convert
+ *
+ * Returns:
+ *   The cycles between vsync and the moment t was read
+ *
+ * Note: Timer 0 counts 1024 cycle ticks since vsync, and timer 1 gives
+ *       the cycles since vsync modulo the length of a scanline. Since a
+ *       tick is shorter than a scanline, only one number of cycles
+ *       within a tick or so of timer 0 matches timer 1.
+ */
+static uint32_t Profile_sinceVsync(const PROFILE_TIME* const t)
+{
+  const uint16_t scanline = profileScanline;
+  const uint32_t coarse = (uint32_t)t->ticks * 1024;
+  const uint16_t fine = (t->phase + scanline - t->vsyncPhase) % scanline;
+  const uint16_t past = (fine + scanline - (uint16_t)(coarse % scanline)) % scanline;
+  if (past < (1024 + scanline) / 2)
+    return coarse + past;
+  return (coarse + past < scanline) ? 0 : coarse + past - scanline; // timer 1 was read slightly before timer 0
+}
+
+// Charges the cycles between two moments to a slot
+static void Profile_add(const uint8_t slot, const PROFILE_TIME* const start, const PROFILE_TIME* const stop)
+{
+  uint32_t cycles = (uint32_t)(uint8_t)(stop->vsyncs - start->vsyncs) * PROFILE_FRAME_LINES * profileScanline;
+  cycles += Profile_sinceVsync(stop);
+  cycles -= Profile_sinceVsync(start);
+  cycles = (cycles > profileOverhead) ? cycles - profileOverhead : 0;
+
+  PROFILE_STATS* const s = &profileStats[slot];
+  const uint16_t clipped = (cycles > 0xFFFF) ? 0xFFFF : cycles;
+  if (s->calls == 0 || clipped < s->min)
+    s->min = clipped;
+  if (clipped > s->max)
+    s->max = clipped;
+  s->total += cycles;
+  if (s->calls != 0xFFFF)
+    ++s->calls;
+}
+
+// Finds the slot of an entity function, where a function that has no enum value, like entity_update_dying, uses the null function's slot
+__attribute__(( optimize("Os") ))
+static uint8_t Profile_slot(const uint8_t kind, void (* const fn)(ENTITY*))
+{
+  uint8_t i = 0;
+  if (kind == PROFILE_INPUT) {
+    for (i = (CPU_OPPONENT == 1) ? CPU_INPUT : AI_FLY_CIRCLE_CCW; i != 0; --i) // without it, CPU_INPUT would find null_input
+      if (inputFunc(i) == fn)
+        break;
+  } else if (kind == PROFILE_UPDATE) {
+    for (i = ENTITY_UPDATE_LADDER; i != 0; --i)
+      if (updateFunc(i) == fn)
+        break;
+  } else {
+    for (i = PLATFORM_RENDER; i != 0; --i)
+      if (renderFunc(i) == fn)
+        break;
+  }
+  return kind + i;
+}
+
+__attribute__(( optimize("Os") ))
+static void Profile_init(void)
+{
+  uint16_t top;
+  uint16_t again;
+  do {
+    top = OCR1A;
+    again = OCR1A;
+  } while (top != again);
+  profileScanline = top + 1;
+
+  PROFILE_TIME start;
+  PROFILE_TIME stop;
+  Profile_now(&start);
+  Profile_now(&stop);
+  profileOverhead = Profile_sinceVsync(&stop) - Profile_sinceVsync(&start);
+}
+
+/*
+ * Profile_report
+ *
+ * Writes the cycles counted on the level that just ended to the uzem
+ * whisper ports, as a 'P', the level number, and then for each slot
+ * that was used, its number, the number of calls, and the fewest,
+ * most, and total cycles, and starts counting the next level
+ *
+ * level [in]
+ *   The level that is about to be loaded
+ */
+__attribute__(( optimize("Os") ))
+static void Profile_report(const uint8_t level)
+{
+  if (profileLevel != 0) {
+    UZEMCHR = 'P';
+    UZEMHEX = profileLevel;
+    for (uint8_t i = 0; i < PROFILE_SLOTS; ++i) {
+      const PROFILE_STATS* const s = &profileStats[i];
+      if (s->calls == 0)
+        continue;
+      UZEMCHR = ' ';
+      UZEMHEX = i;
+      UZEMCHR = ':';
+      UZEMHEX = HI8(s->calls);
+      UZEMHEX = LO8(s->calls);
+      UZEMCHR = ',';
+      UZEMHEX = HI8(s->min);
+      UZEMHEX = LO8(s->min);
+      UZEMCHR = ',';
+      UZEMHEX = HI8(s->max);
+      UZEMHEX = LO8(s->max);
+      UZEMCHR = ',';
+      UZEMHEX = HI8(s->total >> 16);
+      UZEMHEX = LO8(s->total >> 16);
+      UZEMHEX = HI8(s->total);
+      UZEMHEX = LO8(s->total);
+    }
+    UZEMCHR = '\n';
+  }
+  memset(profileStats, 0, sizeof(profileStats));
+  profileLevel = level;
+}
+
+// Calls an entity's input, update, or render function, and charges the cycles it took to the function
+#define PROFILE_CALL(kind, fn, e) do {             \
+    void (* const profileFn)(ENTITY*) = (fn);        \
+    PROFILE_TIME profileStart;                       \
+    PROFILE_TIME profileStop;                        \
+    Profile_now(&profileStart);                      \
+    PERF_COUNT(PERF_CALL);                           \
+    profileFn(e);                                    \
+    Profile_now(&profileStop);                       \
+    Profile_add(Profile_slot(kind, profileFn), &profileStart, &profileStop); \
+  } while (0)
+#define PROFILE_BEGIN(start) PROFILE_TIME start; Profile_now(&start)
+#define PROFILE_END(slot, start) do {             \
+    PROFILE_TIME profileStop;                        \
+    Profile_now(&profileStop);                       \
+    Profile_add(slot, &start, &profileStop);         \
+  } while (0)
+
+#if (MOVING_PLATFORMS == 1)
+// The tests against the platforms are made from inside the update functions, which also count them, in entity.c
+static PROFILE_TIME profilePlatformStart;
+
+void Profile_platformBegin(void)
+{
+  Profile_now(&profilePlatformStart);
+}
+
+void Profile_platformEnd(void)
+{
+  PROFILE_END(PROFILE_PLATFORM, profilePlatformStart);
+}
+#endif // MOVING_PLATFORMS
+#else // PROFILE
+#define PROFILE_CALL(kind, fn, e) (PERF_COUNT(PERF_CALL), (fn)(e))
+#define PROFILE_BEGIN(start)
+#define PROFILE_END(slot, start) ((void)0)
+#endif // PROFILE
+
+#if (PERF_COUNTERS == 1)
+// How many frames each line of counts covers
+#ifndef PERF_COUNTERS_FRAMES
+#define PERF_COUNTERS_FRAMES 16
+#endif // PERF_COUNTERS_FRAMES
+
+// Keep in the same order as enum PERF_COUNTER in entity.h
+const char perfCounterNames[][8] PROGMEM = {
+  "vram", "flash", "overlap", "call", "spawn", "fx",
+};
+
+uint8_t perfCounterFrames;
+
+/*
+ * PerfCounters_frame
+ *
+ * Every PERF_COUNTERS_FRAMES frames, writes the work counted since the
+ * last time to the uzem whisper ports, as a 'C', the level number, and
+ * then each counter's name and count, and starts counting again
+ *
+ * level [in]
+ *   The level being played
+ */
+__attribute__(( optimize("Os") ))
+static void PerfCounters_frame(const uint8_t level)
+{
+  BUILD_BUG_ON(NELEMS(perfCounterNames) != PERF_COUNTERS_N);
+  if (++perfCounterFrames < PERF_COUNTERS_FRAMES)
+    return;
+  perfCounterFrames = 0;
+  UZEMCHR = 'C';
+  UZEMHEX = level;
+  for (uint8_t i = 0; i < PERF_COUNTERS_N; ++i) {
+    UZEMCHR = ' ';
+    // pgm_read_byte_near, since pgm_read_byte would count these reads too
+    for (const char* n = perfCounterNames[i]; pgm_read_byte_near(n) != '\0'; ++n)
+      UZEMCHR = pgm_read_byte_near(n);
+    UZEMCHR = '=';
+    UZEMHEX = HI8(perfCounters[i]);
+    UZEMHEX = LO8(perfCounters[i]);
+  }
+  UZEMCHR = '\n';
+  memset(perfCounters, 0, sizeof(perfCounters));
+}
+#else // PERF_COUNTERS
+#define PerfCounters_frame(level) ((void)0)
+#endif // PERF_COUNTERS
+
+#if (INPUT_SCRIPT == 1)
+#include "data/input_script.inc"
+
+uint8_t scriptRun;
+uint16_t scriptFramesLeft;
+uint16_t scriptButtons;
+
+/*
+ * Script_joypad
+ *
+ * Stands in for ReadJoypad, playing inputScript one frame at a time.
+ * Every frame reads player 1's controller exactly once, through
+ * player_input or the title screen, so each read of it is a frame.
+ *
+ * joypadNo [in]
+ *   The controller to read
+ *
+ * Returns:
+ *   The buttons held
+ */
+unsigned int Script_joypad(const unsigned char joypadNo)
+{
+  if (joypadNo != 0)
+    return 0;
+  if (scriptFramesLeft == 0) {
+    if (scriptRun == NELEMS(inputScript))
+      scriptRun = INPUT_SCRIPT_LOOP;
+    scriptFramesLeft = pgm_read_word(&inputScript[scriptRun][0]);
+    scriptButtons = pgm_read_word(&inputScript[scriptRun][1]);
+    ++scriptRun;
+  }
+  --scriptFramesLeft;
+  return scriptButtons;
+}
+#endif // INPUT_SCRIPT
+
+#if (PLAYERS > 2) && (INPUT_SCRIPT == 0)
+#include <util/delay.h>
+
+// The pin of the joypad port that drives the select line of both multitaps, which is low while their second controllers are read
+#ifndef MULTITAP_SELECT_PIN
+#define MULTITAP_SELECT_PIN PA6
+#endif // MULTITAP_SELECT_PIN
+
+static uint16_t multitapHeld[2]; // the buttons held on controllers 3 and 4, as of the last Multitap_read
+
+/*
+ * Multitap_read
+ *
+ * Reads the second controller plugged into each of the two multitaps,
+ * which are controllers 3 and 4, by latching and clocking the controller
+ * ports the same way the kernel reads controllers 1 and 2, but with the
+ * select line of the multitaps low
+ *
+ * Note: The kernel reads controllers 1 and 2 in its vsync interrupt, so
+ *       this runs right after WaitVsync, when the next read is most of
+ *       a frame away, and puts the select line back high.
+ */
+static void Multitap_read(void)
+{
+  uint16_t held3 = 0;
+  uint16_t held4 = 0;
+  DDRA |= _BV(MULTITAP_SELECT_PIN);
+  JOYPAD_OUT_PORT &= ~_BV(MULTITAP_SELECT_PIN);
+  JOYPAD_OUT_PORT |= _BV(JOYPAD_LATCH_PIN);
+  _delay_us(12);
+  JOYPAD_OUT_PORT &= ~_BV(JOYPAD_LATCH_PIN);
+  for (uint8_t i = 0; i < 16; ++i) {
+    held3 >>= 1;
+    held4 >>= 1;
+    JOYPAD_OUT_PORT &= ~_BV(JOYPAD_CLOCK_PIN);
+    _delay_us(1);
+    if (!(JOYPAD_IN_PORT & _BV(JOYPAD_DATA1_PIN))) // the buttons are active low, and come out in BTN_ order
+      held3 |= 0x8000;
+    if (!(JOYPAD_IN_PORT & _BV(JOYPAD_DATA2_PIN)))
+      held4 |= 0x8000;
+    JOYPAD_OUT_PORT |= _BV(JOYPAD_CLOCK_PIN);
+    _delay_us(1);
+  }
+  JOYPAD_OUT_PORT |= _BV(MULTITAP_SELECT_PIN);
+  multitapHeld[0] = held3;
+  multitapHeld[1] = held4;
+}
+
+/*
+ * Multitap_joypad
+ *
+ * Stands in for ReadJoypad, which the kernel only answers for
+ * controllers 1 and 2
+ *
+ * joypadNo [in]
+ *   The controller to read
+ *
+ * Returns:
+ *   The buttons held
+ */
+unsigned int Multitap_joypad(const unsigned char joypadNo)
+{
+  if (joypadNo < 2)
+    return (ReadJoypad)(joypadNo); // the parentheses call the kernel's function instead of this macro
+  return multitapHeld[joypadNo - 2];
+}
+#else // (PLAYERS > 2) && (INPUT_SCRIPT == 0)
+#define Multitap_read() ((void)0)
+#endif // (PLAYERS > 2) && (INPUT_SCRIPT == 0)
+
+#if (TRACE == 1)
+// Every record starts with one of these bytes, which are never printable, so the decoder can skip the uzem's own messages
+enum TRACE_EVENT;
+typedef enum TRACE_EVENT TRACE_EVENT;
+
+enum TRACE_EVENT {
+  TRACE_FRAME = 0xF0, // frame HI8, vsyncs since the previous frame began
+  TRACE_PHASE,        // phase, ticks / 2 since vsync
+  TRACE_SPAWN,        // sprite
+  TRACE_KILL,         // sprite
+  TRACE_PICKUP,       // player, treasures left
+  TRACE_LEVEL,        // level, ticks / 2 since vsync
+  TRACE_LOADED,       // vsyncs since the level began loading, ticks / 2 since vsync
+};
+
+static uint16_t traceFrame;     // frames since power on, the LO8 of which follows every event
+static uint8_t traceFrameVsync; // frameTimerVsyncs when the frame began
+static uint8_t traceLoadVsync;  // frameTimerVsyncs when the level began loading
+
+static void Trace_event(const TRACE_EVENT event, const uint8_t a)
+{
+  UZEMCHR = event;
+  UZEMCHR = LO8(traceFrame);
+  UZEMCHR = a;
+}
+
+static void Trace_event2(const TRACE_EVENT event, const uint8_t a, const uint8_t b)
+{
+  Trace_event(event, a);
+  UZEMCHR = b;
+}
+
+/*
+ * Trace_frame
+ *
+ * Starts the next frame of the trace, so every event that follows is
+ * given its number
+ *
+ * Note: Call it right after waiting for vsync. A frame that overran
+ *       shows up as more than one vsync since the previous frame.
+ */
+static void Trace_frame(void)
+{
+  const uint8_t vsyncs = frameTimerVsyncs;
+  ++traceFrame;
+  Trace_event2(TRACE_FRAME, HI8(traceFrame), vsyncs - traceFrameVsync);
+  traceFrameVsync = vsyncs;
+}
+
+// Returns the time since vsync in units of 2048 cycles, which fits a whole frame in a byte
+static uint8_t Trace_time(void)
+{
+  const uint16_t ticks = FrameTimer_ticks() / 2;
+  return (ticks > 0xFF) ? 0xFF : ticks;
+}
+
+// Marks the end of a phase, and the start of the next one
+#define Trace_phase(phase) Trace_event2(TRACE_PHASE, phase, Trace_time())
+
+// Marks the start of loading a level, which can take several vsyncs
+static void Trace_level(const uint8_t level)
+{
+  uint8_t time;
+  do {
+    traceLoadVsync = frameTimerVsyncs;
+    time = Trace_time();
+  } while (traceLoadVsync != frameTimerVsyncs);
+  Trace_event2(TRACE_LEVEL, level, time);
+}
+
+// Marks the end of loading a level, before it fades in
+static void Trace_loaded(void)
+{
+  uint8_t vsyncs;
+  uint8_t time;
+  do {
+    vsyncs = frameTimerVsyncs;
+    time = Trace_time();
+  } while (vsyncs != frameTimerVsyncs);
+  Trace_event2(TRACE_LOADED, vsyncs - traceLoadVsync, time);
+}
+#else // TRACE
+#define Trace_event(event, a) ((void)0)
+#define Trace_event2(event, a, b) ((void)0)
+#define Trace_frame() ((void)0)
+#define Trace_phase(phase) ((void)0)
+#define Trace_level(level) ((void)0)
+#define Trace_loaded() ((void)0)
+#endif // TRACE
 
 static void killPlayer(ENTITY* const e)
 {
   if (e->invincible)
     return;
+  Trace_event(TRACE_KILL, e->tag);
+  Particles_burst(e->x, e->y, 4);
   TriggerFx(1, 128, true);
   e->dead = true;
   e->monsterhop = true;
@@ -850,6 +3365,8 @@ static void killMonster(ENTITY* const e)
 {
   if (e->invincible)
     return;
+  Trace_event(TRACE_KILL, e->tag);
+  Particles_burst(e->x, e->y, 4);
   TriggerFx(3, 128, true);         // play the monster death sound
   e->dead = true;                  // kill the monster
   e->interacts = false;            // make sure we don't consider the entity again for collisions
@@ -857,30 +3374,59 @@ static void killMonster(ENTITY* const e)
   e->update = entity_update_dying; // use dying physics
 }
 
-static void spawnMonster(ENTITY* const e, const uint16_t levelOffset, const uint8_t i)
+static void spawnMonster(ENTITY* const e, const uint16_t levelOffset, const LEVEL_HEADER* const header, const uint8_t i)
 {
-  uint8_t input = monsterInput(levelOffset, i);
-  uint8_t update = monsterUpdate(levelOffset, i);
-  uint8_t render = monsterRender(levelOffset, i);
+  // Read the shared profile for this slot as one contiguous record, and then the speed and AI parameters of an override
+  MONSTER_PROFILE profile;
+  const uint8_t index = header->monsterProfile[i];
+  if (index >= NELEMS(monsterProfiles)) {
+    MONSTER_OVERRIDE override;
+    memcpy_P(&override, &monsterOverrides[index - NELEMS(monsterProfiles)], sizeof(MONSTER_OVERRIDE));
+    memcpy_P(&profile, &monsterProfiles[override.profile], sizeof(MONSTER_PROFILE));
+    profile.maxDX = override.maxDX;
+    profile.impulse = override.impulse;
+  } else {
+    memcpy_P(&profile, &monsterProfiles[index], sizeof(MONSTER_PROFILE));
+  }
+  uint8_t input = profile.input;
+  uint8_t update = profile.update;
+  uint8_t render = profile.render;
   uint8_t tx;
   uint8_t ty;
   entityInitialXY(levelOffset, MAX_PLAYERS + i, &tx, &ty);
-  uint8_t monsterFlags = monsterFlags(levelOffset, i);
-  if (tx >= SCREEN_TILES_H || ty >= SCREEN_TILES_V) {
+  uint8_t monsterFlags = header->monsterFlags[i];
+  if (tx >= LEVEL_TILES_H || ty >= SCREEN_TILES_V) {
     input = NULL_INPUT;
     update = NULL_UPDATE;
     render = NULL_RENDER;
     tx = ty = 0;
     monsterFlags |= IFLAG_NOINTERACT;
   }
+#if (WIDE_LEVELS == 1)
+  // Profiles are shared by every screen, so the bounds of horizontal flyers are relative to the screen the monster starts on
+  if (input == AI_FLY_HORIZONTAL || input == AI_FLY_HORIZONTAL_UNDULATE || input == AI_FLY_HORIZONTAL_ERRATIC) {
+    const uint8_t screenX = tx - tx % LEVEL_SCREEN_TILES_H;
+    profile.impulse += LOHI(screenX, screenX);
+  }
+#endif // WIDE_LEVELS
+#if (MOVING_PLATFORMS == 1)
+  if (render == PLATFORM_RENDER) {
+    monsterFlags |= IFLAG_NOINTERACT | IFLAG_INVINCIBLE; // platforms can't hurt, or be hurt by, the players
+    if (platformCount < MAX_PLATFORMS) {
+      platformFrom[platformCount][0] = ht2p(tx); // a platform spawned partway through a frame hasn't moved in it
+      platformFrom[platformCount][1] = vt2p(ty);
+      platforms[platformCount++] = e;
+    }
+  }
+#endif // MOVING_PLATFORMS
   entity_init(e,
               inputFunc(input),
               updateFunc(update),
               renderFunc(render),
-              PLAYERS + i + 4, // offset by 4, so the EXIT sign is between the players and monsters
+              MONSTER_SPRITE(i), // the EXIT sign is between the players and monsters
               tx, ty,
-              (int16_t)(monsterMaxDX(levelOffset, i)),
-              (int16_t)(monsterImpulse(levelOffset, i)));
+              profile.maxDX,
+              profile.impulse);
   // The cast to bool is necessary to properly set bit flags
   e->left = (bool)(monsterFlags & IFLAG_LEFT);
   e->right = (bool)(monsterFlags & IFLAG_RIGHT);
@@ -893,60 +3439,625 @@ static void spawnMonster(ENTITY* const e, const uint16_t levelOffset, const uint
   if (input >= AI_FLY_VERTICAL_UNDULATE) // these AI functions directly manipulate the X and Y values,
     e->input(e);                         // so call input before rendering, so the initial render happens at the proper X,Y
   e->render(e);
+  if (render != NULL_RENDER) {
+    PERF_COUNT(PERF_SPAWN);
+    Trace_event(TRACE_SPAWN, e->tag);
+  }
+}
+
+static void spawnPlayer(PLAYER* const p, const uint16_t levelOffset, const LEVEL_HEADER* const header, const uint8_t i, const uint8_t gameType)
+{
+  // Levels only have MAX_PLAYERS starting positions, so players 3 and 4 start where players 1 and 2 do
+  const uint8_t slot = i % MAX_PLAYERS;
+  uint8_t input = header->playerInput[slot];
+  uint8_t update = header->playerUpdate[slot];
+  uint8_t render = header->playerRender[slot];
+  uint8_t tx;
+  uint8_t ty;
+  entityInitialXY(levelOffset, slot, &tx, &ty);
+  uint8_t playerFlags = header->playerFlags[slot];
+  if ((i == 1) && (gameType & GFLAG_VS_CPU) && input == PLAYER_INPUT)
+    input = CPU_INPUT;
+  if (tx >= LEVEL_TILES_H || ty >= SCREEN_TILES_V || ((i != 0) && (gameType & GFLAG_1P))) {
+    input = NULL_INPUT;
+    update = NULL_UPDATE;
+    render = NULL_RENDER;
+    tx = ty = 0;
+    playerFlags |= IFLAG_NOINTERACT;
+  }
+  player_init(p,
+              inputFunc(input),
+              updateFunc(update),
+              renderFunc(render), i,
+              tx, ty);
+  ENTITY* const e = (ENTITY*)p;
+  if (e->update == entity_update)
+    e->update = player_update;
+  if (input == CPU_INPUT)
+    Cpu_begin();
+  // The cast to bool is necessary to properly set bit flags
+  //e->left = (bool)(playerFlags & IFLAG_LEFT);
+  //e->right = (bool)(playerFlags & IFLAG_RIGHT);
+  //e->up = (bool)(playerFlags & IFLAG_UP);
+  //e->down = (bool)(playerFlags & IFLAG_DOWN);
+  //e->autorespawn = (bool)(playerFlags & IFLAG_AUTORESPAWN);
+  e->interacts = (bool)!(playerFlags & IFLAG_NOINTERACT);
+  e->invincible = (bool)(playerFlags & IFLAG_INVINCIBLE);
+  sprites[e->tag].flags = (playerFlags & IFLAG_SPRITE_FLIP_X) ? SPRITE_FLIP_X : 0;
+  e->render(e);
+  if (render != NULL_RENDER) {
+    PERF_COUNT(PERF_SPAWN);
+    Trace_event(TRACE_SPAWN, e->tag);
+  }
+}
+
+__attribute__(( always_inline ))
+static inline bool overlap(const uint8_t x1, const uint8_t y1, const uint8_t w1, const uint8_t h1, const uint8_t x2, const uint8_t y2, const uint8_t w2, const uint8_t h2)
+{
+  PERF_COUNT(PERF_OVERLAP);
+  return !(((x1 + w1 - 1) < x2) ||
+           ((x2 + w2 - 1) < x1) ||
+           ((y1 + h1 - 1) < y2) ||
+           ((y2 + h2 - 1) < y1));
+}
+
+#if (PLAYERS > 1)
+/*
+ * Players_collide
+ *
+ * Tests each pair of players for overlap, in versus mode, where a player
+ * that comes down on top of another kills it
+ *
+ * player [in/out]
+ *   The players, whose sprites are where they are this frame
+ *
+ * playerPrevY [in]
+ *   The Y of each player's sprite before this frame's update
+ */
+__attribute__(( always_inline ))
+static inline void Players_collide(PLAYER* const player, const uint8_t* const playerPrevY)
+{
+  for (uint8_t i = 0; i < PLAYERS - 1; ++i) {
+    for (uint8_t j = i + 1; j < PLAYERS; ++j) {
+      ENTITY* p1 = (ENTITY*)(&player[i]);
+      ENTITY* p2 = (ENTITY*)(&player[j]);
+      if (p1->interacts && !p1->dead && p2->interacts && !p2->dead &&
+          overlap(sprites[i].x, sprites[i].y, TILE_WIDTH, TILE_HEIGHT, sprites[j].x, sprites[j].y, TILE_WIDTH, TILE_HEIGHT)) {
+        if (((playerPrevY[i] + TILE_HEIGHT - 1) < (playerPrevY[j])) && !p2->invincible) {
+          killPlayer(p2);
+          p2->monsterhop = false; // die like a bug
+          if (p1->update == player_update)
+            p1->monsterhop = true; // player should now do the monster hop, but only if gravity applies
+        } else if (((playerPrevY[j] + TILE_HEIGHT - 1) < (playerPrevY[i])) && !p1->invincible) {
+          killPlayer(p1);
+          p1->monsterhop = false; // die like a bug
+          if (p2->update == player_update)
+            p2->monsterhop = true; // player should now do the monster hop, but only if gravity applies
+        }
+      }
+    }
+  }
+}
+#endif // (PLAYERS > 1)
+
+/*
+ * Monster_collide
+ *
+ * Tests a monster against each player, where a player that comes down on
+ * top of the monster kills it, and otherwise the monster kills the player
+ * (calculation assumes each sprite is WORLD_METER wide, and uses a
+ * shrunken hitbox for the monster)
+ *
+ * m [in/out]
+ *   The monster, whose sprite is where it is this frame
+ *
+ * i [in]
+ *   The monster's slot
+ *
+ * player [in/out]
+ *   The players
+ *
+ * playerPrevY [in]
+ *   The Y of each player's sprite before this frame's update
+ *
+ * monsterPrevY [in]
+ *   The Y of the monster's sprite before this frame's update
+ *
+ * levelScore [in/out]
+ *   The scores, where the player that kills the monster scores
+ */
+__attribute__(( always_inline ))
+static inline void Monster_collide(ENTITY* const m, const uint8_t i, PLAYER* const player, const uint8_t* const playerPrevY,
+                                   const uint8_t monsterPrevY, uint8_t* const levelScore)
+{
+  for (uint8_t p = 0; p < PLAYERS; ++p) {
+    ENTITY* const e = (ENTITY*)(&player[p]);
+    if (m->interacts && !m->dead && e->interacts && !e->dead &&
+        overlap(sprites[p].x, sprites[p].y, TILE_WIDTH, TILE_HEIGHT,
+                sprites[MONSTER_SPRITE(i)].x + 1,
+                sprites[MONSTER_SPRITE(i)].y + 3,
+                TILE_WIDTH - 2, TILE_HEIGHT - 4)) {
+      // If a player and a monster overlap, and the bottom pixel of the player's previous Y is above the top
+      // of the monster's previous Y then the player kills the monster, otherwise the monster kills the player.
+      if (((playerPrevY[p] + TILE_HEIGHT - 1) <= (monsterPrevY + 3)) && !m->invincible) {
+        killMonster(m);
+        BCD_addConstant(&levelScore[SCORE_DIGITS * p], SCORE_DIGITS, KILL_MONSTER_POINTS);
+        Tasks_post(TASK_SCORE);
+        if (e->update == player_update)
+          e->monsterhop = true; // player should now do the monster hop, but only if gravity applies
+      } else {
+        killPlayer(e);
+      }
+    }
+  }
+}
+
+// Set to 1 to run the scripts that png2inc assembles from the .script file next to each level (see LEVEL_SCRIPTS in default/Makefile)
+#ifndef LEVEL_SCRIPTS
+#define LEVEL_SCRIPTS 0
+#endif // LEVEL_SCRIPTS
+
+#if (LEVEL_SCRIPTS == 1)
+#ifndef SCRIPT_BUDGET_STEPS
+#define SCRIPT_BUDGET_STEPS 32 // steps every script thread shares each frame
+#endif // SCRIPT_BUDGET_STEPS
+
+#define SCRIPT_THREADS 4       // must match SCRIPT_THREADS in editor/png2inc.c
+#define SCRIPT_SPAWN_STEPS 4   // steps each monster that SPAWN brings back takes, on top of the step of the instruction
+#define SCRIPT_DONE 0xFF       // pc of a thread that has ended
+
+// Must match scriptOps in editor/png2inc.c
+enum SCRIPT_OP;
+typedef enum SCRIPT_OP SCRIPT_OP;
+
+enum SCRIPT_OP {
+  SCRIPT_END = 0,            // ends the thread
+  SCRIPT_WAIT = 1,           // frames: sleeps for 1-255 frames
+  SCRIPT_WAIT_TREASURES = 2, // n: waits until at least n treasures have been collected
+  SCRIPT_WAIT_CLEAR = 3,     // mask: waits until every monster in the mask is dead
+  SCRIPT_SPAWN = 4,          // mask: brings back each monster in the mask that is dead, where the level data puts it
+  SCRIPT_HIDE = 5,           // mask: takes each monster in the mask out of the level, so a later SPAWN can bring it in
+  SCRIPT_JUMP = 6,           // address: continues at an offset into the code
+  SCRIPT_FIRE = 7,           // y, x1, x2: lights the sky tiles of a row of tiles
+  SCRIPT_DOUSE = 8,          // y, x1, x2: puts out the fire tiles of a row of tiles
+  SCRIPT_TILES = 9,          // y, x1, x2, tile: sets a row of tiles, for doors and tile swaps
+  SCRIPT_OPS_N
+};
+
+const uint8_t scriptOperands[SCRIPT_OPS_N] PROGMEM = { 0, 1, 1, 1, 1, 1, 1, 3, 3, 4 };
+
+// Scripts, grouped by the level they belong to, and ended by 0xFF. png2inc writes
+// one for each level that has a .script file next to it.
+//
+// level, size, threads, entry[threads], code[size - 1 - threads]
+const uint8_t levelScripts[] PROGMEM = {
+#include "editor/levels/level_scripts.inc"
+  0xFF,
+};
+
+static const uint8_t* scriptCode;           // code of the script of the level being played, or NULL for none
+static uint8_t scriptPc[SCRIPT_THREADS];    // offset into scriptCode of each thread's next instruction
+static uint8_t scriptWait[SCRIPT_THREADS];  // frames each thread still sleeps for
+static uint8_t scriptThreads;
+static uint8_t scriptNext;                  // thread that ran out of steps last frame, which goes first
+static uint8_t scriptTreasures;             // treasures the level started with
+
+/*
+ * Script_load
+ *
+ * Finds the script of a level, and starts each of its threads at its
+ * entry point
+ *
+ * level [in]
+ *   The level that was just loaded
+ *
+ * treasures [in]
+ *   The number of treasures in the level
+ *
+ * Note: Only levels that fit on one screen run their script, since the
+ *       tiles a script changes are only changed in vram, and would come
+ *       back when another screen or room of the level is drawn. Endless
+ *       mode passes 0xFF, which no script belongs to.
+ */
+__attribute__(( optimize("Os") ))
+static void Script_load(const uint8_t level, const uint8_t treasures)
+{
+  BUILD_BUG_ON(SCRIPT_BUDGET_STEPS < 1 + SCREEN_TILES_H);                  // the longest row of tiles
+  BUILD_BUG_ON(SCRIPT_BUDGET_STEPS < 1 + SCRIPT_SPAWN_STEPS * MONSTERS); // spawning every monster
+  scriptCode = NULL;
+  scriptTreasures = treasures;
+  scriptNext = 0;
+  if (levelSpan != 1)
+    return;
+  for (const uint8_t* p = levelScripts; pgm_read_byte(p) != 0xFF; p += 2 + pgm_read_byte(p + 1)) {
+    if (pgm_read_byte(p) != level)
+      continue;
+    scriptThreads = pgm_read_byte(p + 2);
+    if (scriptThreads > SCRIPT_THREADS)
+      scriptThreads = SCRIPT_THREADS;
+    scriptCode = p + 3 + pgm_read_byte(p + 2);
+    for (uint8_t t = 0; t < scriptThreads; ++t) {
+      scriptPc[t] = pgm_read_byte(p + 3 + t);
+      scriptWait[t] = 0;
+    }
+    return;
+  }
+}
+
+/*
+ * Script_run
+ *
+ * Runs each thread of the level's script until it waits, or ends, or
+ * the steps of this frame run out, in which case the thread that was
+ * cut off goes first next frame, unless it already ran an instruction
+ * this frame, in which case the thread after it does. The waits of all
+ * the threads count down first, so a thread that never got its turn
+ * still wakes after as many frames as it asked to wait for.
+ *
+ * monster [in/out]
+ *   The monsters, which SPAWN, HIDE, and WAIT_CLEAR act on
+ *
+ * levelOffset [in]
+ *   Offset of the level, which SPAWN reads where monsters start from
+ *
+ * header [in]
+ *   The level's header, which SPAWN reads the monsters' profiles from
+ *
+ * treasuresLeft [in]
+ *   The number of treasures that have not been collected yet
+ *
+ * Note: Each instruction takes a step, and each tile an instruction
+ *       changes takes another one, so no script can take more than
+ *       SCRIPT_BUDGET_STEPS steps in a frame, however it is written.
+ */
+static void Script_run(ENTITY* const monster, const uint16_t levelOffset, const LEVEL_HEADER* const header, const uint8_t treasuresLeft)
+{
+  if (!scriptCode)
+    return;
+  // Every thread's wait counts down, even if the steps run out before the thread gets its turn
+  for (uint8_t i = 0; i < scriptThreads; ++i)
+    if (scriptWait[i] != 0)
+      --scriptWait[i];
+  uint8_t steps = SCRIPT_BUDGET_STEPS;
+  uint8_t t = scriptNext;
+  for (uint8_t n = 0; n < scriptThreads; ++n, t = (t + 1 == scriptThreads) ? 0 : t + 1) {
+    if (scriptWait[t] != 0)
+      continue;
+    bool ran = false;
+    while (scriptPc[t] != SCRIPT_DONE) {
+      const uint8_t* const pc = scriptCode + scriptPc[t];
+      const uint8_t op = pgm_read_byte(pc);
+      if (op >= SCRIPT_OPS_N) {
+        scriptPc[t] = SCRIPT_DONE; // bad code ends the thread instead of running off into the rest of flash
+        break;
+      }
+      const uint8_t a = pgm_read_byte(pc + 1); // the first operand, which is y for a row of tiles
+      uint8_t x1 = 0;
+      uint8_t x2 = 0;
+
+      // Work out what the instruction costs before running it, and leave it for next frame if it does not fit
+      uint8_t cost = 1;
+      if (op >= SCRIPT_FIRE) {
+        x1 = pgm_read_byte(pc + 2);
+        x2 = pgm_read_byte(pc + 3);
+        if (a >= SCREEN_TILES_V || x1 > x2 || x2 >= SCREEN_TILES_H) {
+          scriptPc[t] = SCRIPT_DONE;
+          break;
+        }
+        cost += x2 - x1 + 1;
+      } else if (op == SCRIPT_SPAWN) {
+        for (uint8_t i = 0; i < MONSTERS; ++i)
+          if (a & _BV(i))
+            cost += SCRIPT_SPAWN_STEPS;
+      }
+      if (cost > steps) {
+        // A thread that already ran this frame goes to the back, so one that never waits can't keep the others from running
+        if (ran && ++t == scriptThreads)
+          t = 0;
+        scriptNext = t;
+        return;
+      }
+      steps -= cost;
+      ran = true;
+
+      const uint8_t next = scriptPc[t] + 1 + pgm_read_byte(&scriptOperands[op]);
+      switch (op) {
+      case SCRIPT_END:
+        scriptPc[t] = SCRIPT_DONE;
+        continue;
+      case SCRIPT_WAIT:
+        scriptWait[t] = a;
+        scriptPc[t] = next;
+        goto yield;
+      case SCRIPT_WAIT_TREASURES:
+        if ((uint8_t)(scriptTreasures - treasuresLeft) < a)
+          goto yield;
+        break;
+      case SCRIPT_WAIT_CLEAR:
+        for (uint8_t i = 0; i < MONSTERS; ++i)
+          if ((a & _BV(i)) && !monster[i].dead)
+            goto yield;
+        break;
+      case SCRIPT_SPAWN:
+        for (uint8_t i = 0; i < MONSTERS; ++i)
+          if ((a & _BV(i)) && monster[i].dead)
+            spawnMonster(&monster[i], levelOffset, header, i);
+        break;
+      case SCRIPT_HIDE:
+        for (uint8_t i = 0; i < MONSTERS; ++i) {
+          if (a & _BV(i)) {
+            ENTITY* const e = &monster[i];
+            e->dead = true;
+            e->interacts = false;
+            e->autorespawn = false; // only the script brings it back
+            e->input = null_input;
+            e->update = null_update;
+            e->render = null_render;
+            e->render(e);
+          }
+        }
+        break;
+      case SCRIPT_JUMP:
+        scriptPc[t] = a;
+        continue;
+      case SCRIPT_FIRE:
+        for (uint8_t x = x1; x <= x2; ++x) {
+          const uint8_t tile = GetTile(x, a);
+          if (tile >= FIRST_SKY_TILE && tile <= LAST_SKY_TILE) // treasure stays, so the level can still be finished
+            SetTile(x, a, FIRST_FIRE_TILE);
+        }
+        break;
+      case SCRIPT_DOUSE:
+        for (uint8_t x = x1; x <= x2; ++x)
+          if (isFire(GetTile(x, a)))
+            SetTile(x, a, FIRST_SKY_TILE);
+        break;
+      case SCRIPT_TILES: {
+        const uint8_t tile = pgm_read_byte(pc + 4);
+        for (uint8_t x = x1; x <= x2; ++x)
+          SetTile(x, a, tile);
+        break;
+      }
+      }
+      scriptPc[t] = next;
+    }
+  yield:;
+  }
+}
+#endif // LEVEL_SCRIPTS
+
+#if (DEBUG_OVERLAY == 1)
+#define OVERLAY_TILES 2 // user RAM tiles, which makes each bar 16 pixels long
+#define OVERLAY_X (SCREEN_TILES_H - OVERLAY_TILES)
+#define OVERLAY_SCANLINES 262 // a full bar means the frame was missed
+#define OVERLAY_STACK_BYTES 512 // free stack for a full bar
+#define OVERLAY_COLOR_OK 0x38 // green
+#define OVERLAY_COLOR_LATE 0x07 // red
+#define OVERLAY_COLOR_WORST 0x3f // yellow
+#define OVERLAY_COLOR_STACK 0xff // white
+
+static uint8_t overlayFrameVsyncs; // frameTimerVsyncs when the frame began
+static uint16_t overlayWorst;     // most scanlines any frame has taken on this level
+
+#define DebugOverlay_init() SetUserRamTilesCount(OVERLAY_TILES)
+#define DebugOverlay_reset() (overlayWorst = 0)
+#define DebugOverlay_begin() (overlayFrameVsyncs = frameTimerVsyncs)
+
+// Fills row y of the overlay with a bar that is length pixels long
+static void DebugOverlay_bar(const uint8_t y, uint8_t length, const uint8_t color)
+{
+  for (uint8_t i = 0; i < OVERLAY_TILES; ++i) {
+    uint8_t* const row = GetUserRamTile(i) + y * TILE_WIDTH;
+    for (uint8_t x = 0; x < TILE_WIDTH; ++x)
+      row[x] = (length > x) ? color : 0;
+    length = (length > TILE_WIDTH) ? length - TILE_WIDTH : 0;
+  }
+}
+
+/*
+ * DebugOverlay_draw
+ *
+ * Draws three bars: the scanlines since vsync that this frame has taken,
+ * the most any frame on this level has taken, and the free stack
+ *
+ * Note: Call it last thing before waiting for vsync. The scanlines count
+ *       the kernel's vsync work as well as the game logic, and a frame
+ *       that ran past the next vsync is shown as a full red bar.
+ */
+static void DebugOverlay_draw(void)
+{
+  uint16_t scanlines = (FrameTimer_ticks() * 9) / 16; // 1024 cycles per tick, 1820 per scanline
+  if (frameTimerVsyncs != overlayFrameVsyncs)
+    scanlines = OVERLAY_SCANLINES;
+  if (scanlines > overlayWorst)
+    overlayWorst = scanlines;
+  const uint8_t length = OVERLAY_TILES * TILE_WIDTH;
+  DebugOverlay_bar(0, scanlines * length / OVERLAY_SCANLINES, (scanlines < OVERLAY_SCANLINES) ? OVERLAY_COLOR_OK : OVERLAY_COLOR_LATE);
+  DebugOverlay_bar(1, scanlines * length / OVERLAY_SCANLINES, (scanlines < OVERLAY_SCANLINES) ? OVERLAY_COLOR_OK : OVERLAY_COLOR_LATE);
+  DebugOverlay_bar(3, overlayWorst * length / OVERLAY_SCANLINES, OVERLAY_COLOR_WORST);
+  DebugOverlay_bar(4, overlayWorst * length / OVERLAY_SCANLINES, OVERLAY_COLOR_WORST);
+  const uint16_t stack = StackCount();
+  DebugOverlay_bar(6, (stack < OVERLAY_STACK_BYTES) ? stack * length / OVERLAY_STACK_BYTES : length, OVERLAY_COLOR_STACK);
+  DebugOverlay_bar(7, (stack < OVERLAY_STACK_BYTES) ? stack * length / OVERLAY_STACK_BYTES : length, OVERLAY_COLOR_STACK);
+  for (uint8_t i = 0; i < OVERLAY_TILES; ++i)
+    vram[vramOffset(screenToWorldX(OVERLAY_X + i), 0)] = i; // user RAM tiles are the first tiles in vram
+}
+#endif // DEBUG_OVERLAY
+
+// The last byte of every block written by the EEPROM_WRITER is its commit marker. Zero is used for
+// "committed", so blocks written all at once by EepromWriteBlock (with zeroed reserved bytes) are valid.
+#define EEPROM_MARKER_OFFSET (EEPROM_BLOCK_SIZE - 1)
+#define EEPROM_MARKER_COMMITTED 0x00
+#define EEPROM_MARKER_PENDING 0xFF
+#define EEPROM_BLOCKS ((E2END + 1) / EEPROM_BLOCK_SIZE)
+// The save game, and both level record blocks, can be waiting to be written at the same time
+#define EEPROM_WRITER_QUEUE_SIZE 3
+
+struct EEPROM_WRITER;
+typedef struct EEPROM_WRITER EEPROM_WRITER;
+
+// Writes EEPROM blocks in the background, at most one byte per frame, so a save never stalls the game
+struct EEPROM_WRITER {
+  const uint8_t* block[EEPROM_WRITER_QUEUE_SIZE]; // RAM images of the queued blocks, which must stay valid until they are written
+  uint16_t address[EEPROM_WRITER_QUEUE_SIZE];     // EEPROM addresses of the queued blocks
+  uint8_t queued;                                 // number of queued blocks, the first one is the one being written
+  uint8_t position;                               // next byte of the first queued block to compare
+  bool pending;                                   // true once the first queued block's commit marker has been set to EEPROM_MARKER_PENDING
+};
+
+static EEPROM_WRITER eepromWriter;
+
+// Completion flag: false once every queued block (and its commit marker) has been written
+#define EepromWriter_busy() (eepromWriter.queued != 0)
+
+/*
+ * EepromBlock_address
+ *
+ * Finds the EEPROM address of a block that was created with EepromWriteBlock
+ *
+ * id [in]
+ *   The id of the block
+ *
+ * Returns:
+ *   The EEPROM address of the block, or 0xFFFF if it was not found.
+ */
+__attribute__(( optimize("Os") ))
+static uint16_t EepromBlock_address(const uint16_t id)
+{
+  for (uint16_t address = 0; address < EEPROM_BLOCKS * EEPROM_BLOCK_SIZE; address += EEPROM_BLOCK_SIZE)
+    if ((ReadEeprom(address) | (ReadEeprom(address + 1) << 8)) == id)
+      return address;
+  return 0xFFFF;
+}
+
+/*
+ * EepromWriter_queue
+ *
+ * Queues a block to be written in the background. Call
+ * EepromWriter_update once per frame until EepromWriter_busy() is false.
+ *
+ * address [in]
+ *   The EEPROM address of the block, as returned by EepromBlock_address
+ *
+ * block [in]
+ *   The RAM image of the block, which is read as it is being written,
+ *   so it must stay valid until the write is committed. Its last byte
+ *   is not written, because it is replaced by the commit marker.
+ *
+ * Returns:
+ *   A boolean that is true if the block was queued, or false if the
+ *   queue is full.
+ *
+ *   Note: Queueing a block that is already queued is how changes to
+ *         its RAM image are picked up. If it is the block being
+ *         written, it is compared again from the start, which is safe,
+ *         because its commit marker is still set to pending.
+ */
+__attribute__(( optimize("Os") ))
+static bool EepromWriter_queue(const uint16_t address, const uint8_t* const block)
+{
+  for (uint8_t i = 0; i < eepromWriter.queued; ++i) {
+    if (eepromWriter.address[i] == address) {
+      eepromWriter.block[i] = block;
+      if (i == 0)
+        eepromWriter.position = 0;
+      return true;
+    }
+  }
+
+  if (eepromWriter.queued == EEPROM_WRITER_QUEUE_SIZE)
+    return false;
+  if (eepromWriter.queued == 0) {
+    eepromWriter.position = 0;
+    eepromWriter.pending = false;
+  }
+  eepromWriter.block[eepromWriter.queued] = block;
+  eepromWriter.address[eepromWriter.queued] = address;
+  eepromWriter.queued++;
+  return true;
 }
 
-static void spawnPlayer(PLAYER* const p, const uint16_t levelOffset, const uint8_t i, const uint8_t gameType)
+/*
+ * EepromWriter_update
+ *
+ * Writes at most one byte of the first queued block, and never waits
+ * for the EEPROM. Unchanged bytes are skipped. Before the first changed
+ * byte is written, the block's commit marker is set to pending, and
+ * after the last one it is set back to committed, so a block that was
+ * only partially written when the power was lost can be detected.
+ */
+__attribute__(( optimize("Os") ))
+static void EepromWriter_update(void)
 {
-  uint8_t input = playerInput(levelOffset, i);
-  uint8_t update = playerUpdate(levelOffset, i);
-  uint8_t render = playerRender(levelOffset, i);
-  uint8_t tx;
-  uint8_t ty;
-  entityInitialXY(levelOffset, i, &tx, &ty);
-  uint8_t playerFlags = playerFlags(levelOffset, i);
-  if (tx >= SCREEN_TILES_H || ty >= SCREEN_TILES_V || ((i == 1) && (gameType & GFLAG_1P))) {
-    input = NULL_INPUT;
-    update = NULL_UPDATE;
-    render = NULL_RENDER;
-    tx = ty = 0;
-    playerFlags |= IFLAG_NOINTERACT;
+  if (!EepromWriter_busy() || (EECR & (1 << EEPE))) // idle, or the previous byte is still being written
+    return;
+
+  const uint16_t base = eepromWriter.address[0];
+  const uint8_t* const block = eepromWriter.block[0];
+  while (eepromWriter.position < EEPROM_MARKER_OFFSET) {
+    const uint16_t address = base + eepromWriter.position;
+    if (ReadEeprom(address) != block[eepromWriter.position]) {
+      if (!eepromWriter.pending) {
+        WriteEeprom(base + EEPROM_MARKER_OFFSET, EEPROM_MARKER_PENDING);
+        eepromWriter.pending = true;
+      } else {
+        WriteEeprom(address, block[eepromWriter.position++]);
+      }
+      return;
+    }
+    ++eepromWriter.position;
   }
-  player_init(p,
-              inputFunc(input),
-              updateFunc(update),
-              renderFunc(render), i,
-              tx, ty);
-  ENTITY* const e = (ENTITY*)p;
-  if (e->update == entity_update)
-    e->update = player_update;
-  // The cast to bool is necessary to properly set bit flags
-  //e->left = (bool)(playerFlags & IFLAG_LEFT);
-  //e->right = (bool)(playerFlags & IFLAG_RIGHT);
-  //e->up = (bool)(playerFlags & IFLAG_UP);
-  //e->down = (bool)(playerFlags & IFLAG_DOWN);
-  //e->autorespawn = (bool)(playerFlags & IFLAG_AUTORESPAWN);
-  e->interacts = (bool)!(playerFlags & IFLAG_NOINTERACT);
-  e->invincible = (bool)(playerFlags & IFLAG_INVINCIBLE);
-  sprites[e->tag].flags = (playerFlags & IFLAG_SPRITE_FLIP_X) ? SPRITE_FLIP_X : 0;
-  e->render(e);
+
+  if (ReadEeprom(base + EEPROM_MARKER_OFFSET) != EEPROM_MARKER_COMMITTED) {
+    WriteEeprom(base + EEPROM_MARKER_OFFSET, EEPROM_MARKER_COMMITTED);
+    return; // the next block is started on a later frame
+  }
+
+  // This block is committed, so move on to the next one
+  for (uint8_t i = 1; i < eepromWriter.queued; ++i) {
+    eepromWriter.block[i - 1] = eepromWriter.block[i];
+    eepromWriter.address[i - 1] = eepromWriter.address[i];
+  }
+  eepromWriter.queued--;
+  eepromWriter.position = 0;
+  eepromWriter.pending = false;
 }
 
-__attribute__(( always_inline ))
-static inline bool overlap(const uint8_t x1, const uint8_t y1, const uint8_t w1, const uint8_t h1, const uint8_t x2, const uint8_t y2, const uint8_t w2, const uint8_t h2)
+/*
+ * EepromBlock_load
+ *
+ * Reads a block into RAM, creating it if it does not exist yet
+ *
+ * id [in]
+ *   The id of the block
+ *
+ * block [out]
+ *   The RAM image of the block
+ *
+ * Returns:
+ *   The EEPROM address of the block, or 0xFFFF if it could not be
+ *   created. When the block was only partially written when the power
+ *   was lost, every byte after the id is zeroed.
+ *
+ *   Note: Creating a block writes it all at once, which only happens
+ *         the first time the game is run, while the title screen is
+ *         still faded out.
+ */
+__attribute__(( optimize("Os") ))
+static uint16_t EepromBlock_load(const uint16_t id, uint8_t* const block)
 {
-  return !(((x1 + w1 - 1) < x2) ||
-           ((x2 + w2 - 1) < x1) ||
-           ((y1 + h1 - 1) < y2) ||
-           ((y2 + h2 - 1) < y1));
+  memset(block, 0, EEPROM_BLOCK_SIZE);
+  if (EepromReadBlock(id, (struct EepromBlockStruct*)block) == EEPROM_ERROR_BLOCK_NOT_FOUND) {
+    memset(block, 0, EEPROM_BLOCK_SIZE);
+    block[0] = LO8(id);
+    block[1] = HI8(id);
+    EepromWriteBlock((struct EepromBlockStruct*)block);
+  } else if (block[EEPROM_MARKER_OFFSET] != EEPROM_MARKER_COMMITTED) { // the power was lost while writing it, so it may be corrupt
+    memset(block + sizeof(uint16_t), 0, EEPROM_BLOCK_SIZE - sizeof(uint16_t));
+  }
+  return EepromBlock_address(id);
 }
 
-/* volatile uint8_t globalFrameCounter = 0; */
-
-/* void VsyncCallBack() */
-/* { */
-/*   ++globalFrameCounter; */
-/* } */
-
 #define EEPROM_ID 0x0089
 #define EEPROM_SAVEGAME_VERSION 0x0001
 
@@ -957,35 +4068,383 @@ struct EEPROM_SAVEGAME {
   uint16_t id;
   uint16_t version;
   uint8_t score[SCORE_DIGITS];
-  char reserved[32 - 4 - SCORE_DIGITS];
+  char reserved[32 - 4 - SCORE_DIGITS - 1];
+  uint8_t marker; // see EEPROM_MARKER_OFFSET
 } __attribute__ ((packed));
 
+// RAM copy of the save game, which is read from the EEPROM only the first time the title screen is shown
+static EEPROM_SAVEGAME saveGame;
+static uint16_t saveGameAddress = 0xFFFF;
+
 __attribute__(( optimize("Os") ))
 static void LoadHighScore(uint8_t* const highScore)
 {
-  EEPROM_SAVEGAME save = {0};
-  uint8_t retval = EepromReadBlock(EEPROM_ID, (struct EepromBlockStruct*)&save);
-  if (retval == EEPROM_ERROR_BLOCK_NOT_FOUND || save.version == 0xFFFF) {
-    save.id = EEPROM_ID;
-    save.version = EEPROM_SAVEGAME_VERSION;
-    EepromWriteBlock((struct EepromBlockStruct*)&save);
+  BUILD_BUG_ON(sizeof(EEPROM_SAVEGAME) != EEPROM_BLOCK_SIZE);
+  if (saveGameAddress == 0xFFFF) {
+    saveGameAddress = EepromBlock_load(EEPROM_ID, (uint8_t*)&saveGame);
+    if (saveGame.version == 0xFFFF || saveGame.version == 0) { // newly created, or corrupt
+      saveGame.version = EEPROM_SAVEGAME_VERSION;
+      BCD_zero(saveGame.score, SCORE_DIGITS);
+    }
   }
+
   uint8_t digits = SCORE_DIGITS;
   while (digits--)
-    highScore[digits] = save.score[digits];
+    highScore[digits] = saveGame.score[digits];
 }
 
 __attribute__(( optimize("Os") ))
 static void SaveHighScore(const uint8_t* score)
 {
-  EEPROM_SAVEGAME save = {0};
-  save.id = EEPROM_ID;
-  save.version = EEPROM_SAVEGAME_VERSION;
+  if (saveGameAddress == 0xFFFF)
+    return;
+
   uint8_t digits = SCORE_DIGITS;
   while (digits--)
-    save.score[digits] = score[digits];
-  EepromWriteBlock((struct EepromBlockStruct*)&save);
+    saveGame.score[digits] = score[digits];
+  EepromWriter_queue(saveGameAddress, (const uint8_t*)&saveGame);
+}
+
+// The best clear time and best score for each level are bit-packed into the data bytes (between the
+// id and the commit marker) of LEVEL_RECORD_BLOCKS EEPROM blocks, and cached in RAM after the title
+// screen is first shown. Each field saturates at its maximum value, and a time of 0 means no record.
+// There are as many blocks as every level but the title and victory screens needs, so a new level adds
+// a block once the others are full, and the levels already recorded keep their place.
+#define EEPROM_LEVEL_RECORDS_ID(block) (EEPROM_ID | 0x8000 | ((block) << 8)) // outside the range of assigned ids
+#define LEVEL_RECORD_DATA_SIZE (EEPROM_MARKER_OFFSET - sizeof(uint16_t))
+#define LEVEL_RECORD_TIME_BITS 11  // clear time in units of (1 << LEVEL_RECORD_TIME_SHIFT) frames, 0 means no record
+#define LEVEL_RECORD_TIME_SHIFT 3  // 8 frames, which is how often the time bonus counts down
+#define LEVEL_RECORD_SCORE_BITS 11 // points scored in the level, including the time bonus
+#define LEVEL_RECORD_BITS (LEVEL_RECORD_TIME_BITS + LEVEL_RECORD_SCORE_BITS)
+#define LEVEL_RECORD_BLOCKS (((LEVELS - 2) * LEVEL_RECORD_BITS + LEVEL_RECORD_DATA_SIZE * 8 - 1) / (LEVEL_RECORD_DATA_SIZE * 8))
+#define LEVEL_RECORDS ((LEVEL_RECORD_BLOCKS * LEVEL_RECORD_DATA_SIZE * 8) / LEVEL_RECORD_BITS)
+
+static uint8_t levelRecords[LEVEL_RECORD_BLOCKS][EEPROM_BLOCK_SIZE];
+static uint16_t levelRecordsAddress[LEVEL_RECORD_BLOCKS] = { [0 ... LEVEL_RECORD_BLOCKS - 1] = 0xFFFF };
+
+/*
+ * LevelRecords_bits
+ *
+ * Reads, and optionally replaces, a bit field in the RAM copy of the
+ * level records
+ *
+ * first [in]
+ *   The index of the first (least significant) bit of the field
+ *
+ * count [in]
+ *   The number of bits in the field
+ *
+ * value [in]
+ *   The new value of the field, or 0xFFFF to leave it unchanged
+ *
+ * Returns:
+ *   The previous value of the field.
+ */
+__attribute__(( optimize("Os") ))
+static uint16_t LevelRecords_bits(const uint16_t first, const uint8_t count, const uint16_t value)
+{
+  uint16_t previous = 0;
+  for (uint8_t i = 0; i < count; ++i) {
+    const uint16_t bit = first + i;
+    uint8_t* const byte = &levelRecords[bit / (LEVEL_RECORD_DATA_SIZE * 8)][sizeof(uint16_t) + (bit % (LEVEL_RECORD_DATA_SIZE * 8)) / 8];
+    const uint8_t mask = 1 << (bit % 8);
+    if (*byte & mask)
+      previous |= (1 << i);
+    if (value != 0xFFFF) {
+      if (value & (1 << i))
+        *byte |= mask;
+      else
+        *byte &= ~mask;
+    }
+  }
+  return previous;
+}
+
+__attribute__(( optimize("Os") ))
+static void LoadLevelRecords(void)
+{
+  for (uint8_t i = 0; i < LEVEL_RECORD_BLOCKS; ++i)
+    if (levelRecordsAddress[i] == 0xFFFF)
+      levelRecordsAddress[i] = EepromBlock_load(EEPROM_LEVEL_RECORDS_ID(i), levelRecords[i]);
+}
+
+/*
+ * SaveLevelRecord
+ *
+ * Updates the records for a level, and queues any block that changed
+ * to be written in the background
+ *
+ * level [in]
+ *   The level that was cleared, where the title screen, and the levels
+ *   of a level pack past the built-in ones, are ignored
+ *
+ * frames [in]
+ *   How many frames it took to clear the level
+ *
+ * points [in]
+ *   How many points were scored in the level, including the time bonus
+ */
+__attribute__(( optimize("Os") ))
+static void SaveLevelRecord(const uint8_t level, const uint16_t frames, const uint32_t points)
+{
+  BUILD_BUG_ON(LEVELS - 2 > LEVEL_RECORDS); // every level has a record
+  if (level == 0 || level > LEVEL_RECORDS)
+    return;
+
+  const uint16_t first = (level - 1) * LEVEL_RECORD_BITS;
+  uint16_t time = (frames + (1 << LEVEL_RECORD_TIME_SHIFT) - 1) >> LEVEL_RECORD_TIME_SHIFT;
+  if (time == 0)
+    time = 1;
+  else if (time > (1 << LEVEL_RECORD_TIME_BITS) - 1)
+    time = (1 << LEVEL_RECORD_TIME_BITS) - 1;
+  const uint16_t score = (points > (1 << LEVEL_RECORD_SCORE_BITS) - 1) ? (1 << LEVEL_RECORD_SCORE_BITS) - 1 : (uint16_t)points;
+
+  const uint16_t bestTime = LevelRecords_bits(first, LEVEL_RECORD_TIME_BITS, 0xFFFF);
+  if (bestTime == 0 || time < bestTime)
+    LevelRecords_bits(first, LEVEL_RECORD_TIME_BITS, time);
+  if (bestTime == 0 || score > LevelRecords_bits(first + LEVEL_RECORD_TIME_BITS, LEVEL_RECORD_SCORE_BITS, 0xFFFF))
+    LevelRecords_bits(first + LEVEL_RECORD_TIME_BITS, LEVEL_RECORD_SCORE_BITS, score);
+
+  // Only the (at most two) blocks that hold the record are queued, so the writer queue keeps room for other saves
+  const uint8_t last = (first + LEVEL_RECORD_BITS - 1) / (LEVEL_RECORD_DATA_SIZE * 8);
+  for (uint8_t i = first / (LEVEL_RECORD_DATA_SIZE * 8); i <= last; ++i)
+    if (levelRecordsAddress[i] != 0xFFFF)
+      EepromWriter_queue(levelRecordsAddress[i], levelRecords[i]);
+}
+
+// Set to 0 to disable ghost runs, which replay the best 1P run of a level using the last player's (otherwise unused) entity and sprite
+#ifndef GHOST_RUNS
+#if (PLAYERS > 1)
+#define GHOST_RUNS 1
+#else
+#define GHOST_RUNS 0 // there is no spare player entity
+#endif
+#endif // GHOST_RUNS
+
+#if (GHOST_RUNS == 1)
+#if (PLAYERS < 2)
+#error GHOST_RUNS requires PLAYERS >= 2
+#endif // (PLAYERS < 2)
+
+// A run is the player 0 controller stream for one level, stored as (buttons, duration) pairs. The buttons that
+// matter fit in one byte, by moving BTN_A into the unused BTN_Y bit. The BTN_SELECT bit records a monster hop,
+// which is the only way the live player's physics depends on something the ghost doesn't interact with.
+#define GHOST_RUN_SIZE 40 // pairs, a run that needs more than this is not kept
+#define GHOST_RUN_OVERFLOW 0xFF
+#define GHOST_BUTTONS (BTN_B | BTN_UP | BTN_DOWN | BTN_LEFT | BTN_RIGHT)
+#define GHOST_BTN_A BTN_Y
+#define GHOST_MONSTERHOP BTN_SELECT
+
+// The best run of each level is kept, back to back, in a store shared by every level. When a new best run doesn't
+// fit, the runs that were kept the longest ago make room for it.
+#ifndef GHOST_STORE_PAIRS
+#define GHOST_STORE_PAIRS 64
+#endif // GHOST_STORE_PAIRS
+#ifndef GHOST_STORE_RUNS
+#define GHOST_STORE_RUNS 6
+#endif // GHOST_STORE_RUNS
+
+struct GHOST_RUN;
+typedef struct GHOST_RUN GHOST_RUN;
+
+struct GHOST_RUN {
+  uint8_t level;
+  uint8_t length;   // number of pairs, or GHOST_RUN_OVERFLOW
+  uint16_t frames;  // how many frames it took to clear the level
+} __attribute__ ((packed));
+
+struct GHOST;
+typedef struct GHOST GHOST;
+
+struct GHOST {
+  GHOST_RUN recording;                      // the run being recorded
+  uint8_t pair[GHOST_RUN_SIZE][2];          // and its pairs
+  GHOST_RUN kept[GHOST_STORE_RUNS];         // the best run of each level in the store, the oldest first
+  uint8_t store[GHOST_STORE_PAIRS][2];      // the pairs of the kept runs, in the same order
+  uint8_t runs;      // number of kept runs
+  uint8_t position;  // next pair in the store to replay
+  uint8_t end;       // the pair in the store after the last one of the run being replayed
+  uint8_t remaining; // frames left in the pair being replayed
+  uint8_t buttons;   // buttons of the pair being replayed
+  uint8_t blink;
+};
+
+static GHOST ghost;
+
+static void ghost_input(ENTITY* const e)
+{
+  if (ghost.remaining == 0) {
+    if (ghost.position == ghost.end) { // the ghost has reached the exit
+      e->input = null_input;
+      e->update = null_update;
+      e->render = null_render;
+      return;
+    }
+    ghost.buttons = ghost.store[ghost.position][0];
+    ghost.remaining = ghost.store[ghost.position][1];
+    ghost.position++;
+  }
+  ghost.remaining--;
+
+  player_input_buttons(e, (ghost.buttons & GHOST_BUTTONS) | ((ghost.buttons & GHOST_BTN_A) ? BTN_A : 0));
+  if (ghost.buttons & GHOST_MONSTERHOP)
+    e->monsterhop = true;
+}
+
+static void ghost_render(ENTITY* const e)
+{
+  player_render(e);
+  if ((ghost.blink ^= 1)) // show the ghost every other frame, so it can't be mistaken for a real player
+    sprites[e->tag].x = OFF_SCREEN;
+}
+
+/*
+ * Ghost_find
+ *
+ * Finds the kept run of a level
+ *
+ * level [in]
+ *   The level to look for
+ *
+ * start [out]
+ *   The index in the store of the first pair of the run
+ *
+ * Returns:
+ *   The index of the run in kept, or ghost.runs if the level has none
+ */
+__attribute__(( optimize("Os") ))
+static uint8_t Ghost_find(const uint8_t level, uint8_t* const start)
+{
+  uint8_t i = 0;
+  for (*start = 0; i < ghost.runs && ghost.kept[i].level != level; ++i)
+    *start += ghost.kept[i].length;
+  return i;
+}
+
+// Takes a run out of the store, moving the runs kept after it down to close the gap
+__attribute__(( optimize("Os") ))
+static void Ghost_forget(const uint8_t i, const uint8_t start)
+{
+  uint8_t used = start;
+  for (uint8_t j = i; j < ghost.runs; ++j)
+    used += ghost.kept[j].length;
+  const uint8_t length = ghost.kept[i].length;
+  memmove(ghost.store[start], ghost.store[start + length], (used - start - length) * sizeof(ghost.store[0]));
+  memmove(&ghost.kept[i], &ghost.kept[i + 1], (ghost.runs - i - 1) * sizeof(GHOST_RUN));
+  ghost.runs--;
+}
+
+/*
+ * Ghost_begin
+ *
+ * Starts recording player 0, and spawns a ghost that replays the best
+ * run of this level, if there is one
+ *
+ * g [out]
+ *   The (otherwise unused) entity of the last player to use for the ghost
+ *
+ * p [in]
+ *   The player 0 entity, which must have just been spawned
+ *
+ * level [in]
+ *   The level that was just loaded
+ */
+__attribute__(( optimize("Os") ))
+static void Ghost_begin(PLAYER* const g, const PLAYER* const p, const uint8_t level)
+{
+  ghost.recording.level = level;
+  ghost.recording.length = 0;
+  ghost.remaining = 0;
+  ghost.position = ghost.end = 0;
+
+  uint8_t start;
+  const uint8_t i = Ghost_find(level, &start);
+  if (i == ghost.runs || levelSpan > 1) // the ghost could leave the screen that is shown
+    return;
+#if (BREAKABLE_TILES == 1)
+  if (breakableRuns) // the ghost would not see the tiles its run broke, or would run into the ones this run breaks
+    return;
+#endif // BREAKABLE_TILES
+  ghost.position = start;
+  ghost.end = start + ghost.kept[i].length;
+
+  // The ghost starts out as an exact copy of player 0, so the same inputs produce the same motion
+  *g = *p;
+  ENTITY* const e = (ENTITY*)g;
+  e->tag = PLAYERS - 1;
+  e->input = ghost_input;
+  e->render = ghost_render;
+  e->interacts = false;
+  e->invincible = true;
+  sprites[e->tag].flags = sprites[0].flags;
+}
+
+/*
+ * Ghost_record
+ *
+ * Appends one frame of player 0's input to the run being recorded, and
+ * must be called after player 0's input function, but before its update
+ * function, so a pending monster hop is recorded on the frame it is used
+ *
+ * p [in]
+ *   The player 0 entity
+ */
+static void Ghost_record(const PLAYER* const p)
+{
+  GHOST_RUN* const r = &ghost.recording;
+  if (r->length == GHOST_RUN_OVERFLOW)
+    return;
+
+  const uint8_t buttons = (p->buttons.held & GHOST_BUTTONS) |
+                          ((p->buttons.held & BTN_A) ? GHOST_BTN_A : 0) |
+                          (((const ENTITY*)p)->monsterhop ? GHOST_MONSTERHOP : 0);
+  if (r->length && ghost.pair[r->length - 1][0] == buttons && ghost.pair[r->length - 1][1] != 0xFF) {
+    ghost.pair[r->length - 1][1]++;
+  } else if (r->length == GHOST_RUN_SIZE) {
+    r->length = GHOST_RUN_OVERFLOW;
+  } else {
+    ghost.pair[r->length][0] = buttons;
+    ghost.pair[r->length][1] = 1;
+    r->length++;
+  }
+}
+
+/*
+ * Ghost_end
+ *
+ * Keeps the run that was just recorded in place of the level's kept run,
+ * if it cleared the level faster, and runs while the screen fades out
+ *
+ * frames [in]
+ *   How many frames it took to clear the level
+ */
+__attribute__(( optimize("Os") ))
+static void Ghost_end(const uint16_t frames)
+{
+  BUILD_BUG_ON(GHOST_RUN_SIZE > GHOST_STORE_PAIRS || GHOST_STORE_PAIRS > 255);
+  GHOST_RUN* const r = &ghost.recording;
+  if (r->length == GHOST_RUN_OVERFLOW)
+    return;
+
+  uint8_t start;
+  uint8_t i = Ghost_find(r->level, &start);
+  if (i != ghost.runs) {
+    if (frames >= ghost.kept[i].frames)
+      return;
+    Ghost_forget(i, start);
+  }
+  ghost.position = ghost.end; // the run being replayed may move, so the ghost stops
+
+  // Make room by forgetting the runs that were kept the longest ago (no level is 0xFF, so this finds the end of the store)
+  uint8_t used;
+  while ((i = Ghost_find(0xFF, &used)) == GHOST_STORE_RUNS || used + r->length > GHOST_STORE_PAIRS)
+    Ghost_forget(0, 0);
+  r->frames = frames;
+  ghost.kept[i] = *r;
+  memcpy(ghost.store[used], ghost.pair, r->length * sizeof(ghost.pair[0]));
+  ghost.runs++;
 }
+#endif // GHOST_RUNS
 
 const uint8_t copyright[] PROGMEM = {
   LAST_FIRE_TILE + 9, FIRST_SKY_TILE, FIRST_DIGIT_TILE + 2,
@@ -1006,13 +4465,13 @@ const uint8_t x_player[] PROGMEM = {
   LAST_FIRE_TILE + 14,
 };
 
-#if (PLAYERS == 2)
+#if (PLAYERS > 1)
 const uint8_t p1_vs_p2[] PROGMEM = {
   FIRST_DIGIT_TILE + 10, FIRST_DIGIT_TILE + 1, FIRST_SKY_TILE,
   LAST_FIRE_TILE + 1, LAST_FIRE_TILE + 2, FIRST_SKY_TILE,
   FIRST_DIGIT_TILE + 10, FIRST_DIGIT_TILE + 2,
 };
-#endif // (PLAYERS == 2)
+#endif // (PLAYERS > 1)
 
 __attribute__(( optimize("Os") ))
 static GAME_FLAGS doTitleScreen(ENTITY* const monster, uint8_t* highScore)
@@ -1021,21 +4480,22 @@ static GAME_FLAGS doTitleScreen(ENTITY* const monster, uint8_t* highScore)
   SetTileTable((tileset + (TILE_WIDTH * TILE_HEIGHT) * ((TILESET_SIZE - TITLE_SCREEN_TILES) / (THEMES_N)) * 2) + 
                (TILE_WIDTH * TILE_HEIGHT) * ((TILESET_SIZE - TITLE_SCREEN_TILES) / (3 * THEMES_N)) * 2);
 
-  uint16_t offset = 13 * SCREEN_TILES_H + 5;
+  uint16_t offset = vramOffset(5, 13);
   for (uint8_t i = 0; i < NELEMS(copyright); ++i)
     vram[offset + i] = pgm_read_byte(&copyright[i]) + RAM_TILES_COUNT;
 
-#if (PLAYERS == 2)
-  offset = 21 * SCREEN_TILES_H + 11;
+#if (PLAYERS > 1)
+  offset = vramOffset(11, 21);
   for (uint8_t i = 0; i < NELEMS(p1_vs_p2); ++i)
     vram[offset + i] = pgm_read_byte(&p1_vs_p2[i]) + RAM_TILES_COUNT;
-#endif // (PLAYERS == 2)
+#endif // (PLAYERS > 1)
 
-  offset = 17 * SCREEN_TILES_H + 11;
-  for (uint8_t i = 0; i < PLAYERS; ++i) {
-    vram[offset + (SCREEN_TILES_H * 2 * i)] = FIRST_DIGIT_TILE + 1 + i + RAM_TILES_COUNT;
+  // The menu only has room for a 1 player and an all players line
+  for (uint8_t i = 0; i < ((PLAYERS > 1) ? 2 : 1); ++i) {
+    offset = vramOffset(11, 17 + 2 * i);
+    vram[offset] = FIRST_DIGIT_TILE + (i ? PLAYERS : 1) + RAM_TILES_COUNT;
     for (uint8_t j = 0; j < NELEMS(x_player); ++j)
-      vram[offset + (SCREEN_TILES_H * 2 * i) + 2 + j] = pgm_read_byte(&x_player[j]) + RAM_TILES_COUNT;
+      vram[offset + 2 + j] = pgm_read_byte(&x_player[j]) + RAM_TILES_COUNT;
   }
 
   // Set pointer to 1P
@@ -1048,10 +4508,14 @@ static GAME_FLAGS doTitleScreen(ENTITY* const monster, uint8_t* highScore)
   bool wasReleased = false;
 
   LoadHighScore(highScore);
+  LoadLevelRecords();
 
   sprites[0].x -= 4;
 
   for (;;) {
+#if (LEVEL_GENERATOR == 1)
+    ++endlessSeed;
+#endif // LEVEL_GENERATOR
     if (selection == 0 && (highScore[0] || highScore[1] || highScore[2] || highScore[3] || highScore[4])) { // 1P
       // Using SetTile here results in smaller code
       SetTile(11, 24, LAST_FIRE_TILE + 10);
@@ -1059,7 +4523,7 @@ static GAME_FLAGS doTitleScreen(ENTITY* const monster, uint8_t* highScore)
       BCD_display(14, 24, highScore, SCORE_DIGITS);
     } else {
       // erase the display of the high score
-      offset = 24 * SCREEN_TILES_H + 11;
+      offset = vramOffset(11, 24);
       for (uint8_t i = 0; i < 8; ++i)
         vram[offset + i] = FIRST_SKY_TILE + RAM_TILES_COUNT;
     }
@@ -1082,7 +4546,7 @@ static GAME_FLAGS doTitleScreen(ENTITY* const monster, uint8_t* highScore)
     held = ReadJoypad(0);
     uint16_t pressed = held & (held ^ prev);
 
-#if (PLAYERS == 2)
+#if (PLAYERS > 1)
     // Check for mode switch buttons
     if (pressed & BTN_DOWN) {
       TriggerFx(3, 128, true);
@@ -1094,37 +4558,295 @@ static GAME_FLAGS doTitleScreen(ENTITY* const monster, uint8_t* highScore)
       if (--selection == 255)
         selection = 2;
     }
-#endif // (PLAYERS == 2)
+#endif // (PLAYERS > 1)
 
     if ((held & BTN_START) == 0)
       wasReleased = true;
 
     if ((pressed & BTN_START) && wasReleased) {
       TriggerFx(2, 128, true);
-#if (PLAYERS == 2)
+#if (PLAYERS > 1)
       for (uint8_t j = 0; j < 3; ++j) {
         if (j != selection) {
-          offset = (17 + (2 * j)) * SCREEN_TILES_H + 11;
+          offset = vramOffset(11, 17 + (2 * j));
           for (uint8_t i = 0; i < 8; ++i)
             vram[offset + i] = FIRST_SKY_TILE + RAM_TILES_COUNT;
         }
       }
-#endif // (PLAYERS == 2)
+#endif // (PLAYERS > 1)
 
       WaitVsync(32);
+      GAME_FLAGS endless = 0;
+#if (LEVEL_GENERATOR == 1)
+      if (held & BTN_SELECT) // holding SELECT while pressing START plays generated levels
+        endless = GFLAG_ENDLESS;
+#endif // LEVEL_GENERATOR
       switch (selection) {
       case 0:
-        return GFLAG_1P;
+        return GFLAG_1P | endless;
       case 1:
-        return GFLAG_2P;
+        return GFLAG_2P | endless;
       default: // case 2
-        return GFLAG_P1_VS_P2;
+#if (CPU_OPPONENT == 1)
+        if (held & BTN_B) // holding B while pressing START has the CPU play player 2
+          return GFLAG_P1_VS_P2 | GFLAG_VS_CPU | endless;
+#endif // CPU_OPPONENT
+        return GFLAG_P1_VS_P2 | endless;
       }
     }
 
     WaitVsync(1);
+    EepromWriter_update();
+  }
+}
+
+// The score display has room for the scores of two players, which are players 1 and 2, or in a four player game, every
+// HUD_PAIR_FRAMES frames it swaps to players 3 and 4 and back, since the levels leave no other row free of the playfield
+#define hudScoreX(i) (((i) & 1) ? 23 : 14)
+#if (PLAYERS > 2)
+#define HUD_PAIR_FRAMES 128 // a power of 2, at most 256
+
+static uint8_t hudPair; // the first of the two players whose scores are shown
+#else // (PLAYERS > 2)
+#define hudPair 0
+#endif // (PLAYERS > 2)
+
+// Displays the level number and the player numbers, which only change when the score display has to be redrawn
+__attribute__(( optimize("Os") ))
+static void DisplayHud(const uint8_t currentLevel, const uint8_t gameType)
+{
+  if (currentLevel != victoryLevel(gameType)) { // don't display the level number on the victory screen
+    uint8_t levelDisplay[2] = {0};
+    BCD_addConstant(levelDisplay, 2, currentLevel);
+    BCD_display(2, 0, levelDisplay, 2); // display the level number
+  }
+
+  // Display the player numbers, to the left of each score
+  for (uint8_t i = 0; i < ((gameType & GFLAG_1P) ? 1 : ((PLAYERS > 1) ? 2 : 1)); ++i) {
+    const uint16_t offset = vramOffset(screenToWorldX(hudScoreX(i) - 3), 0);
+    vram[offset] = FIRST_DIGIT_TILE + 10 + RAM_TILES_COUNT;
+    vram[vramRight(offset)] = FIRST_DIGIT_TILE + 1 + hudPair + i + RAM_TILES_COUNT;
+  }
+}
+
+// Shows the exit sign above where player 0 started
+static void ShowExitSign(const uint16_t levelOffset)
+{
+  uint8_t tx;
+  uint8_t ty;
+  entityInitialXY(levelOffset, 0, &tx, &ty);
+#if (WIDE_LEVELS == 1)
+  tx -= cameraX;
+  if (tx >= SCREEN_TILES_H - 1) { // the sign is two tiles wide, and it has to be entirely on screen to be shown
+    hide_exit_sign();
+    return;
+  }
+#endif // WIDE_LEVELS
+#if (ROOM_LEVELS == 1)
+  if (currentRoom != 0) { // the exit is in the first room
+    hide_exit_sign();
+    return;
+  }
+#endif // ROOM_LEVELS
+  show_exit_sign(tx, ty - 1);
+}
+
+#if (ROOM_LEVELS == 1)
+// Returns the ROOM_EDGE_* bit of the edge an interacting player is leaving the current room through, or 0
+__attribute__(( always_inline ))
+static inline uint8_t Room_leaving(const ENTITY* const e)
+{
+  uint8_t edge = 0;
+  if (e->x == 0 && e->left)
+    edge = ROOM_EDGE_LEFT;
+  else if (e->x == ENTITY_MAX_X && e->right)
+    edge = ROOM_EDGE_RIGHT;
+  else if (e->y == 0 && (e->dy < 0 || e->up)) // player_update keeps the momentum of a jump at the top edge
+    edge = ROOM_EDGE_UP;
+  else if (e->y == ENTITY_MAX_Y) // player_update does not kill a player falling out of the bottom into another room
+    edge = ROOM_EDGE_DOWN;
+  return (e->interacts && !e->dead) ? (edge & roomExits) : 0;
+}
+
+/*
+ * Room_enter
+ *
+ * Swaps the neighboring room in for the current one, without fading out,
+ * by redrawing vram from the room's level data, and respawning its monsters
+ *
+ * edge [in]
+ *   The ROOM_EDGE_* the player is leaving through
+ *
+ * player [in/out]
+ *   The players. The one that is leaving comes in through the opposite
+ *   edge of the new room, and the other one is brought along with it.
+ *
+ * leaving [in]
+ *   Index of the player that is leaving
+ *
+ * monster [in/out]
+ *   The monsters, which are respawned from the new room, except for the
+ *   ones that were killed (and don't autorespawn) the last time it was shown
+ *
+ * levelOffset [out]
+ *   Set to the level data of the new room, for spawning and respawning
+ *
+ * header [in/out]
+ *   Replaced by the header of the new room, but the theme of the first
+ *   room is kept, since all rooms share one tileset
+ *
+ * Note: The cost is one DecodeMap and AutotileMap, the same as the base
+ *       map part of LoadLevel, plus respawning the monsters, which a
+ *       PROFILE build charges to its own slot. Treasure that was collected
+ *       is not drawn again.
+ */
+__attribute__(( optimize("Os") ))
+static void Room_enter(const uint8_t edge, PLAYER* const player, const uint8_t leaving, ENTITY* const monster, uint16_t* const levelOffset, LEVEL_HEADER* const header)
+{
+  BUILD_BUG_ON(MONSTERS > 8); // roomMonstersKilled has one bit per monster
+  for (uint8_t i = 0; i < MONSTERS; ++i)
+    if (monster[i].dead && !monster[i].autorespawn)
+      roomMonstersKilled[currentRoom] |= (1 << i);
+#if (BREAKABLE_TILES == 1)
+  Breakable_crumble(true); // tiles that were crumbling in the room being left are gone when it is entered again
+#endif // BREAKABLE_TILES
+
+  if (edge == ROOM_EDGE_LEFT)
+    --currentRoom;
+  else if (edge == ROOM_EDGE_RIGHT)
+    ++currentRoom;
+  else if (edge == ROOM_EDGE_UP)
+    currentRoom -= roomColumns;
+  else
+    currentRoom += roomColumns;
+  roomExits = Room_exits();
+
+  *levelOffset = screenOffset[currentRoom];
+  const uint8_t theme = header->theme;
+  levelRead(header, &levelBytes[*levelOffset], sizeof(LEVEL_HEADER));
+  header->theme = theme;
+  DrawLevel(*levelOffset);
+
+  ENTITY* const e = (ENTITY*)&player[leaving];
+  if (edge == ROOM_EDGE_LEFT)
+    e->x = ENTITY_MAX_X;
+  else if (edge == ROOM_EDGE_RIGHT)
+    e->x = 0;
+  else if (edge == ROOM_EDGE_UP)
+    e->y = ENTITY_MAX_Y;
+  else
+    e->y = 0;
+  for (uint8_t i = 0; i < PLAYERS; ++i) {
+    ENTITY* const p = (ENTITY*)&player[i];
+    if (i != leaving && p->interacts && !p->dead) {
+      p->x = e->x;
+      p->y = e->y;
+      p->dx = p->dy = 0;
+    }
+    p->render(p);
+  }
+
+#if (MOVING_PLATFORMS == 1)
+  platformCount = 0;
+#endif // MOVING_PLATFORMS
+#if (PROJECTILES > 0)
+  projectile_reset(); // projectiles in flight stay behind in the room being left
+#endif // PROJECTILES
+  Particles_reset();
+  for (uint8_t i = 0; i < MONSTERS; ++i) {
+    ENTITY* const m = &monster[i];
+    spawnMonster(m, *levelOffset, header, i);
+    if (roomMonstersKilled[currentRoom] & (1 << i)) {
+      m->input = null_input;
+      m->update = null_update;
+      m->render = null_render;
+      m->dead = true;
+      m->interacts = false;
+      m->render(m);
+    }
+  }
+}
+#endif // ROOM_LEVELS
+
+// Set to 1 for a debug build that measures the stack used by each phase of a frame (see STACK_PHASES in default/Makefile)
+#ifndef STACK_PHASES
+#define STACK_PHASES 0
+#endif // STACK_PHASES
+
+#if (STACK_PHASES == 1) || (TRACE == 1)
+enum FRAME_PHASE;
+typedef enum FRAME_PHASE FRAME_PHASE;
+
+enum FRAME_PHASE {
+  PHASE_INPUT,
+  PHASE_UPDATE,
+  PHASE_RENDER,
+  PHASE_COLLIDE,
+  PHASE_HUD,
+  PHASE_LOAD,
+  PHASES_N
+};
+#endif // (STACK_PHASES == 1) || (TRACE == 1)
+
+#if (STACK_PHASES == 1)
+const char stackPhaseNames[PHASES_N] PROGMEM = { 'I', 'U', 'R', 'C', 'H', 'L' };
+static uint16_t stackHeadroom[PHASES_N]; // fewest bytes of stack left unused by each phase on the current level
+static uint8_t stackLevel;               // level the headroom was measured on, or 0 for none
+
+/*
+ * StackPhase_sample
+ *
+ * Charges the stack used since the previous sample to a phase, and
+ * keeps the lowest headroom each phase has had on the current level
+ *
+ * phase [in]
+ *   The phase that just ran
+ *
+ * Note: Each sample scans the unused part of the stack from the bottom,
+ *       which makes this build noticeably slower, so it is only for
+ *       measuring.
+ */
+static void StackPhase_sample(const FRAME_PHASE phase)
+{
+  const uint16_t headroom = StackSample();
+  if (headroom < stackHeadroom[phase])
+    stackHeadroom[phase] = headroom;
+}
+
+/*
+ * StackPhase_report
+ *
+ * Writes the headroom of each phase on the level that just ended to the
+ * uzem whisper ports, as an 'S', the level number, and then each phase
+ * letter followed by its headroom in bytes, and starts measuring the
+ * next level
+ *
+ * level [in]
+ *   The level that is about to be loaded
+ */
+__attribute__(( optimize("Os") ))
+static void StackPhase_report(const uint8_t level)
+{
+  if (stackLevel != 0) {
+    UZEMCHR = 'S';
+    UZEMHEX = stackLevel;
+    for (uint8_t i = 0; i < PHASES_N; ++i) {
+      UZEMCHR = pgm_read_byte(&stackPhaseNames[i]);
+      UZEMHEX = HI8(stackHeadroom[i]);
+      UZEMHEX = LO8(stackHeadroom[i]);
+    }
+    UZEMCHR = '\n';
   }
+  memset(stackHeadroom, 0xFF, sizeof(stackHeadroom));
+  stackLevel = level;
+  StackSample(); // what was used before the level loads is not charged to any phase
 }
+#else // STACK_PHASES
+#define StackPhase_sample(phase) ((void)0)
+#endif // STACK_PHASES
+
+// Marks the end of a phase of the frame, and the start of the next one, for the debug builds that measure them
+#define FRAME_PHASE(phase) do { StackPhase_sample(phase); Trace_phase(phase); } while (0)
 
 int main()
 {
@@ -1135,19 +4857,33 @@ int main()
   uint8_t highScore[SCORE_DIGITS] = {0};
   uint8_t currentLevel;
   uint16_t levelOffset;
-  uint8_t theme;
+  LEVEL_HEADER levelHeader;
   uint8_t backgroundFrameCounter;
   uint8_t timer[TIMER_DIGITS];
   uint8_t gameType;
   uint8_t treasuresLeft;
   uint8_t levelEndTimer;
+  uint16_t levelFrames;
+
+  BUILD_BUG_ON(PROJECTILE_SPRITE(PROJECTILES) > MAX_SPRITES); // see MAX_SPRITES in default/Makefile
 
-  /* SetUserRamTilesCount(1); */
   SetSpritesTileBank(0, mysprites);
   InitMusicPlayer(patches);
+#if (LEVEL_PACK == 1)
+  levelPackLevels = LevelPack_open();
+#endif // LEVEL_PACK
+#if (DEBUG_OVERLAY == 1) || (TRACE == 1) || (PROFILE == 1)
+  FrameTimer_init();
+#endif // (DEBUG_OVERLAY == 1) || (TRACE == 1) || (PROFILE == 1)
+#if (PROFILE == 1)
+  Profile_init();
+#endif // PROFILE
+#if (DEBUG_OVERLAY == 1)
+  DebugOverlay_init();
+#endif // DEBUG_OVERLAY
 
  title_screen:
-  levelOffset = theme = levelEndTimer = treasuresLeft = 0;
+  levelOffset = levelEndTimer = treasuresLeft = 0;
   currentLevel = 0;
   gameType = GFLAG_1P;
 
@@ -1160,13 +4896,30 @@ int main()
     SetTileTable(tileset);
 
     uint16_t timeBonus = 0;
+#if (STACK_PHASES == 1)
+    StackPhase_report(currentLevel);
+#endif // STACK_PHASES
+#if (PROFILE == 1)
+    Profile_report(currentLevel);
+#endif // PROFILE
+#if (DEBUG_OVERLAY == 1)
+    DebugOverlay_reset();
+#endif // DEBUG_OVERLAY
+    Trace_level(currentLevel);
 /* __asm__ __volatile__ ("wdr"); */
 /*     // Wait until all sound effects have stopped playing to avoid sound glitches */
 /*     while ((tracks[0].flags | tracks[1].flags) & TRACK_FLAGS_PLAYING) */
 /*       WaitVsync(1); */
 /*     SetRenderingParameters(262 - 80, 80); */
 
-    levelOffset = LoadLevel(currentLevel, &theme, &treasuresLeft, &timeBonus);
+    PROFILE_BEGIN(loadStart); // generating a level is charged to LoadLevel too
+#if (LEVEL_GENERATOR == 1)
+    if ((gameType & GFLAG_ENDLESS) && currentLevel != 0)
+      levelOffset = GenerateLevel(endlessSeed, currentLevel - 1, &levelHeader, &treasuresLeft, &timeBonus);
+    else
+#endif // LEVEL_GENERATOR
+      levelOffset = LoadLevel(currentLevel, &levelHeader, &treasuresLeft, &timeBonus);
+    PROFILE_END(PROFILE_LOAD, loadStart);
 
     // Convert timeBonus into unpacked BCD and store in timer[TIMER_DIGITS] array (not time critical)
     BCD_zero(timer, TIMER_DIGITS);
@@ -1180,23 +4933,44 @@ int main()
 /*     SetRenderingParameters(FIRST_RENDER_LINE, FRAME_LINES); */
 /* __asm__ __volatile__ ("wdr"); */
 
-    /* SetUserPostVsyncCallback(&VsyncCallBack);   */
-
     // Check the return value of LoadLevel
     if (levelOffset == 0xFFFF)
       goto title_screen;
 
     backgroundFrameCounter = 0;
+    Tasks_reset();
+#if (PLAYERS > 2)
+    hudPair = 0;
+#endif // (PLAYERS > 2)
 
     // Initialize players
     for (uint8_t i = 0; i < PLAYERS; ++i)
-      spawnPlayer(&player[i], levelOffset, i, gameType);
+      spawnPlayer(&player[i], levelOffset, &levelHeader, i, gameType);
 
     // Initialize monsters
+#if (MOVING_PLATFORMS == 1)
+    platformCount = 0;
+#endif // MOVING_PLATFORMS
+#if (PROJECTILES > 0)
+    projectile_reset();
+#endif // PROJECTILES
+    Particles_reset();
     for (uint8_t i = 0; i < MONSTERS; ++i)
-      spawnMonster(&monster[i], levelOffset, i);
+      spawnMonster(&monster[i], levelOffset, &levelHeader, i);
+#if (LEVEL_SCRIPTS == 1)
+    Script_load((gameType & GFLAG_ENDLESS) ? 0xFF : currentLevel, treasuresLeft);
+    Script_run(monster, levelOffset, &levelHeader, treasuresLeft); // monsters that the script hides never show up
+#endif // LEVEL_SCRIPTS
+
+#if (GHOST_RUNS == 1)
+    if ((gameType & GFLAG_1P) && !(gameType & GFLAG_ENDLESS) && currentLevel != 0)
+      Ghost_begin(&player[PLAYERS - 1], &player[0], currentLevel);
+#endif // GHOST_RUNS
+    FRAME_PHASE(PHASE_LOAD);
+    Trace_loaded();
 
     levelEndTimer = 0;
+    levelFrames = 0;
     BCD_copy(levelScore, gameScore, SCORE_DIGITS * PLAYERS);
 
     if (currentLevel == 0) {
@@ -1205,69 +4979,87 @@ int main()
       BCD_zero(gameScore, SCORE_DIGITS * PLAYERS);
       continue;
     } else {
-      if (currentLevel == LEVELS - 1) {
-        BCD_zero(timer, TIMER_DIGITS); // don't display the timer or level number on the victory screen
-      } else {
-        uint8_t levelDisplay[2] = {0};
-        BCD_addConstant(levelDisplay, 2, currentLevel);
-        BCD_display(2, 0, levelDisplay, 2); // display the level number
-      }
+      if (currentLevel == victoryLevel(gameType))
+        BCD_zero(timer, TIMER_DIGITS); // don't display the timer on the victory screen
+      DisplayHud(currentLevel, gameType);
 
       FadeIn(1, true);
     }
 
-    // Display the player numbers
-    uint16_t offset = 0 * SCREEN_TILES_H + 11;
-    vram[offset] = FIRST_DIGIT_TILE + 10 + RAM_TILES_COUNT;
-    vram[offset + 1] = FIRST_DIGIT_TILE + 1 + RAM_TILES_COUNT;
-
-    if (!(gameType & GFLAG_1P)) {
-      offset = 0 * SCREEN_TILES_H + 20;
-      vram[offset] = FIRST_DIGIT_TILE + 10 + RAM_TILES_COUNT;
-      vram[offset + 1] = FIRST_DIGIT_TILE + 2 + RAM_TILES_COUNT;
-    }
-
     // Main game loop
     for (;;) {
-      /* static uint8_t localFrameCounter; */
       WaitVsync(1);
+      Multitap_read();
+      Trace_frame();
+      PerfCounters_frame(currentLevel);
+#if (DEBUG_OVERLAY == 1)
+      DebugOverlay_begin();
+#endif // DEBUG_OVERLAY
+      EepromWriter_update();
+      if (levelEndTimer == 0 && levelFrames != 0xFFFF)
+        ++levelFrames;
 /* __asm__ __volatile__ ("wdr"); */
 
-      /* uint8_t* ramTile = GetUserRamTile(0); */
-      /* CopyFlashTile(0, 0); */
-      /* ramTile[27] = 0x07; */
-      /* vram[0] = 0; */
+      PROFILE_BEGIN(hudStart);
+#if (PLAYERS > 2)
+      if (!(gameType & GFLAG_1P) && (taskFrame & (HUD_PAIR_FRAMES - 1)) == HUD_PAIR_FRAMES - 1) {
+        hudPair ^= 2;
+        DisplayHud(currentLevel, gameType);
+        Tasks_post(TASK_SCORE);
+      }
+#endif // (PLAYERS > 2)
+      const uint8_t tasks = Tasks_next();
 
       // Animate all background tiles at once by modifying the tileset pointer
-      if ((backgroundFrameCounter % BACKGROUND_FRAME_SKIP) == 0) {
-        SetTileTable((tileset + (TILE_WIDTH * TILE_HEIGHT) * ((TILESET_SIZE - TITLE_SCREEN_TILES) / (THEMES_N)) * theme) + 
+      if (tasks & _BV(TASK_BACKGROUND)) {
+        PROFILE_BEGIN(taskStart);
+        SetTileTable((tileset + (TILE_WIDTH * TILE_HEIGHT) * ((TILESET_SIZE - TITLE_SCREEN_TILES) / (THEMES_N)) * levelHeader.theme) + 
                      (TILE_WIDTH * TILE_HEIGHT) * ((TILESET_SIZE - TITLE_SCREEN_TILES) / (3 * THEMES_N)) *
                      pgm_read_byte(&backgroundAnimation[backgroundFrameCounter / BACKGROUND_FRAME_SKIP]));
-
-        // Decrement, and display the time bonus timer if its value is greater than zero
-        if (timer[0] || timer[1] || timer[2]) {
-          BCD_decrement(timer, TIMER_DIGITS);
-          BCD_display(6, 0, timer, TIMER_DIGITS);
-        }
+        PROFILE_END(PROFILE_TASK + TASK_BACKGROUND, taskStart);
       }
       // Compile-time assert that we are working with a power of 2
       BUILD_BUG_ON(isNotPowerOf2(BACKGROUND_FRAME_SKIP * NELEMS(backgroundAnimation)));
       backgroundFrameCounter = (backgroundFrameCounter + 1) & (BACKGROUND_FRAME_SKIP * NELEMS(backgroundAnimation) - 1);
 
+      // Decrement, and display the time bonus timer if its value is greater than zero
+      if ((tasks & _BV(TASK_TIMER)) && (timer[0] || timer[1] || timer[2])) {
+        PROFILE_BEGIN(taskStart);
+        BCD_decrement(timer, TIMER_DIGITS);
+        BCD_display(6, 0, timer, TIMER_DIGITS);
+        PROFILE_END(PROFILE_TASK + TASK_TIMER, taskStart);
+      }
+
       // Display the score(s)
-      BCD_display(14, 0, &levelScore[0], SCORE_DIGITS);
-#if (PLAYERS == 2)
-      if (!(gameType & GFLAG_1P))
-        BCD_display(23, 0, &levelScore[SCORE_DIGITS], SCORE_DIGITS);
-#endif // (PLAYERS == 2)
+      if (tasks & _BV(TASK_SCORE)) {
+        PROFILE_BEGIN(taskStart);
+        BCD_display(hudScoreX(0), 0, &levelScore[SCORE_DIGITS * hudPair], SCORE_DIGITS);
+#if (PLAYERS > 1)
+        if (!(gameType & GFLAG_1P))
+          BCD_display(hudScoreX(1), 0, &levelScore[SCORE_DIGITS * (hudPair + 1)], SCORE_DIGITS);
+#endif // (PLAYERS > 1)
+        PROFILE_END(PROFILE_TASK + TASK_SCORE, taskStart);
+      }
+      PROFILE_END(PROFILE_HUD, hudStart);
+      FRAME_PHASE(PHASE_HUD);
 
 /* __asm__ __volatile__ ("wdr"); */
 
-      // Display debugging information
-      /* uint16_t sc = StackCount(); */
-      /* DisplayNumber(SCREEN_TILES_H - 3, 1, sc, 4); */
-      /* DisplayNumber(2, 0, globalFrameCounter, 3); */
-      /* DisplayNumber(6, 0, localFrameCounter++, 3); */
+#if (MOVING_PLATFORMS == 1)
+      // Platforms move before anything that can ride them, so platform_land knows where each one was and went this frame
+      for (uint8_t i = 0; i < platformCount; ++i) {
+        ENTITY* const p = platforms[i];
+        platformFrom[i][0] = p->x;
+        platformFrom[i][1] = p->y;
+#if (WIDE_LEVELS == 1)
+        if (!Camera_contains(p))
+          continue;
+#endif // WIDE_LEVELS
+        PROFILE_CALL(PROFILE_INPUT, p->input, p);
+        PROFILE_CALL(PROFILE_UPDATE, p->update, p);
+      }
+      FRAME_PHASE(PHASE_UPDATE);
+#endif // MOVING_PLATFORMS
 
       // Proper kill detection requires the previous Y value for each entity
       uint8_t playerPrevY[PLAYERS];
@@ -1276,72 +5068,136 @@ int main()
       for (uint8_t i = 0; i < PLAYERS; ++i) {
         ENTITY* e = (ENTITY*)(&player[i]);
         playerPrevY[i] = sprites[i].y; // cache the previous Y value to use for kill detection below
-        e->input(e);
+        PROFILE_CALL(PROFILE_INPUT, e->input, e);
+#if (GHOST_RUNS == 1)
+        if (i == 0 && (gameType & GFLAG_1P) && levelEndTimer == 0)
+          Ghost_record(&player[0]);
+#endif // GHOST_RUNS
+        FRAME_PHASE(PHASE_INPUT);
+#if (BREAKABLE_TILES == 1)
+        const int16_t prevDY = e->dy;
+#endif // BREAKABLE_TILES
   /* __asm__ __volatile__ ("wdr"); */
-        e->update(e);
+        PROFILE_CALL(PROFILE_UPDATE, e->update, e);
+#if (BREAKABLE_TILES == 1)
+        Breakable_touch(e, prevDY);
+#endif // BREAKABLE_TILES
+        FRAME_PHASE(PHASE_UPDATE);
+#if (WIDE_LEVELS == 1)
+        if (i != 0) {
+          Camera_clamp(e);
+        } else if (Camera_follow(e)) {
+          FRAME_PHASE(PHASE_LOAD); // streaming in the new columns
+          DisplayHud(currentLevel, gameType);
+          Tasks_post(TASK_SCORE);
+          if (currentLevel != victoryLevel(gameType))
+            BCD_display(6, 0, timer, TIMER_DIGITS);
+          if (treasuresLeft == 0 && levelEndTimer <= WORLD_FALLING_GRACE_FRAMES + 1) // the exit sign is still being shown
+            ShowExitSign(levelOffset);
+          FRAME_PHASE(PHASE_HUD);
+        }
+#endif // WIDE_LEVELS
+#if (ROOM_LEVELS == 1)
+        const uint8_t edge = Room_leaving(e);
+        if (edge) {
+          PROFILE_BEGIN(roomStart);
+          Room_enter(edge, player, i, monster, &levelOffset, &levelHeader);
+          PROFILE_END(PROFILE_ROOM, roomStart);
+          FRAME_PHASE(PHASE_LOAD);
+          for (uint8_t j = 0; j < PLAYERS; ++j)
+            playerPrevY[j] = sprites[j].y; // the players were moved, so nobody lands on anybody
+          DisplayHud(currentLevel, gameType);
+          Tasks_post(TASK_SCORE);
+          if (currentLevel != victoryLevel(gameType))
+            BCD_display(6, 0, timer, TIMER_DIGITS);
+          if (treasuresLeft == 0)
+            ShowExitSign(levelOffset);
+          FRAME_PHASE(PHASE_HUD);
+        }
+#endif // ROOM_LEVELS
   /* __asm__ __volatile__ ("wdr"); */
-        e->render(e);
-      }
-
-#if (PLAYERS == 2)
-      // Collision check between players (only in versus mode)
-      if (gameType & GFLAG_P1_VS_P2) {
-        ENTITY* p1 = (ENTITY*)(&player[0]);
-        ENTITY* p2 = (ENTITY*)(&player[1]);
-        if (p1->interacts && !p1->dead && p2->interacts && !p2->dead &&
-            overlap(sprites[0].x, sprites[0].y, TILE_WIDTH, TILE_HEIGHT, sprites[1].x, sprites[1].y, TILE_WIDTH, TILE_HEIGHT)) {
-          if (((playerPrevY[0] + TILE_HEIGHT - 1) < (playerPrevY[1])) && !p2->invincible) {
-            killPlayer(p2);
-            p2->monsterhop = false; // die like a bug
-            if (p1->update == player_update)
-              p1->monsterhop = true; // player should now do the monster hop, but only if gravity applies
-          } else if (((playerPrevY[1] + TILE_HEIGHT - 1) < (playerPrevY[0])) && !p1->invincible) {
-            killPlayer(p1);
-            p1->monsterhop = false; // die like a bug
-            if (p2->update == player_update)
-              p2->monsterhop = true; // player should now do the monster hop, but only if gravity applies
-          }
+        PROFILE_CALL(PROFILE_RENDER, e->render, e);
+        FRAME_PHASE(PHASE_RENDER);
+#if (PROJECTILES > 0)
+        // Players (but not the ghost) throw projectiles in the direction they face
+        if ((player[i].buttons.pressed & BTN_X) && e->input == player_input && e->interacts && !e->dead) {
+          const uint8_t j = projectile_spawn(e->x, e->y, (sprites[i].flags & SPRITE_FLIP_X) ? PROJECTILE_DX : -PROJECTILE_DX, PROJECTILE_DY, i);
+          if (j != PROJECTILE_NONE)
+            Trace_event(TRACE_SPAWN, PROJECTILE_SPRITE(j));
         }
+#endif // PROJECTILES
       }
-#endif // (PLAYERS == 2)
+#if (BREAKABLE_TILES == 1)
+      Breakable_crumble(false);
+      FRAME_PHASE(PHASE_UPDATE);
+#endif // BREAKABLE_TILES
+
+#if (PLAYERS > 1)
+      // Collision check between each pair of players (only in versus mode)
+      if (gameType & GFLAG_P1_VS_P2)
+        Players_collide(player, playerPrevY);
+      FRAME_PHASE(PHASE_COLLIDE);
+#endif // (PLAYERS > 1)
 
       // Get inputs/update the state of the monsters, and perform collision detection with each player
       for (uint8_t i = 0; i < MONSTERS; ++i) {
-        uint8_t monsterPrevY = sprites[PLAYERS + i + 4].y; // cache the previous Y value to use for kill detection below
-        monster[i].input(&monster[i]);
-        monster[i].update(&monster[i]);
-        monster[i].render(&monster[i]);
-
-        // Collision detection (calculation assumes each sprite is WORLD_METER wide, and uses a shrunken hitbox for the monster)
-        for (uint8_t p = 0; p < PLAYERS; ++p) {
-          ENTITY* const e = (ENTITY*)(&player[p]);
-          if (monster[i].interacts && !monster[i].dead && e->interacts && !e->dead &&
-              overlap(sprites[p].x, sprites[p].y, TILE_WIDTH, TILE_HEIGHT,
-                      sprites[PLAYERS + i + 4].x + 1,
-                      sprites[PLAYERS + i + 4].y + 3,
-                      TILE_WIDTH - 2, TILE_HEIGHT - 4)) {
-            // If a player and a monster overlap, and the bottom pixel of the player's previous Y is above the top
-            // of the monster's previous Y then the player kills the monster, otherwise the monster kills the player.
-            if (((playerPrevY[p] + TILE_HEIGHT - 1) <= (monsterPrevY + 3)) && !monster[i].invincible) {
-              killMonster(&monster[i]);
-  /* __asm__ __volatile__ ("wdr"); */
-              BCD_addConstant(&levelScore[SCORE_DIGITS * p], SCORE_DIGITS, KILL_MONSTER_POINTS);
-  /* __asm__ __volatile__ ("wdr"); */
-              if (e->update == player_update)
-                e->monsterhop = true; // player should now do the monster hop, but only if gravity applies
-            } else {
-              killPlayer(e);
+        uint8_t monsterPrevY = sprites[MONSTER_SPRITE(i)].y; // cache the previous Y value to use for kill detection below
+#if (WIDE_LEVELS == 1)
+        if (!Camera_contains(&monster[i])) {
+          sprites[MONSTER_SPRITE(i)].x = OFF_SCREEN;
+          continue;
+        }
+#endif // WIDE_LEVELS
+        if (!isPlatform(&monster[i])) { // platforms have already moved, before the players
+          PROFILE_CALL(PROFILE_INPUT, monster[i].input, &monster[i]);
+          FRAME_PHASE(PHASE_INPUT);
+          PROFILE_CALL(PROFILE_UPDATE, monster[i].update, &monster[i]);
+          FRAME_PHASE(PHASE_UPDATE);
+        }
+        PROFILE_CALL(PROFILE_RENDER, monster[i].render, &monster[i]);
+        FRAME_PHASE(PHASE_RENDER);
+
+        Monster_collide(&monster[i], i, player, playerPrevY, monsterPrevY, levelScore);
+        FRAME_PHASE(PHASE_COLLIDE);
+      }
+
+#if (PROJECTILES > 0)
+      // Walk only the projectiles in flight, and test the center of each against the same shrunken monster hitbox as above
+      for (uint8_t i = projectileLive, prev = PROJECTILE_NONE; i != PROJECTILE_NONE;) {
+        PROJECTILE* const p = &projectiles[i];
+        const uint8_t next = p->next;
+        bool hit = !projectile_update(p);
+        if (!hit) {
+          projectile_render(i);
+          for (uint8_t j = 0; j < MONSTERS; ++j) {
+            if (monster[j].interacts && !monster[j].dead && !monster[j].invincible &&
+                overlap(sprites[PROJECTILE_SPRITE(i)].x + TILE_WIDTH / 2, sprites[PROJECTILE_SPRITE(i)].y + TILE_HEIGHT / 2, 1, 1,
+                        sprites[MONSTER_SPRITE(j)].x + 1,
+                        sprites[MONSTER_SPRITE(j)].y + 3,
+                        TILE_WIDTH - 2, TILE_HEIGHT - 4)) {
+              killMonster(&monster[j]);
+              BCD_addConstant(&levelScore[SCORE_DIGITS * p->owner], SCORE_DIGITS, KILL_MONSTER_POINTS);
+              Tasks_post(TASK_SCORE);
+              hit = true;
+              break;
             }
           }
         }
+        if (hit)
+          projectile_despawn(i, prev); // prev stays the same, since it now links to next
+        else
+          prev = i;
+        i = next;
       }
+      FRAME_PHASE(PHASE_UPDATE);
+#endif // PROJECTILES
 
       // Check if the dead flag has been set for a monster and/or if we need to respawn a monster
       for (uint8_t i = 0; i < MONSTERS; ++i) {
         if (monster[i].interacts && monster[i].dead)
           killMonster(&monster[i]);
         if (monster[i].dead && monster[i].autorespawn && monster[i].render == null_render) // monster is dead, and its dying animation has finished
-          spawnMonster(&monster[i], levelOffset, i);
+          spawnMonster(&monster[i], levelOffset, &levelHeader, i);
       }
 
       // Check if the dead flag has been set for a player
@@ -1351,6 +5207,14 @@ int main()
           killPlayer(e);
       }
 
+#if (LEVEL_SCRIPTS == 1)
+      // Run the level's script before the environmental collisions, so a player touches the fire it lights this frame
+      PROFILE_BEGIN(scriptStart);
+      Script_run(monster, levelOffset, &levelHeader, treasuresLeft);
+      PROFILE_END(PROFILE_SCRIPT, scriptStart);
+      FRAME_PHASE(PHASE_UPDATE);
+#endif // LEVEL_SCRIPTS
+
       // Check for environmental collisions (treasure, fire) by looping over the interacting players, converting
       // their (x, y) coordinates into tile coordinates, and checking any overlapping tiles.
       for (uint8_t i = 0; i < PLAYERS; ++i) {
@@ -1367,10 +5231,10 @@ int main()
           uint8_t treasureCollected = 0;
           bool killedByFire = false;
 
-          uint16_t offset = ty * SCREEN_TILES_H + tx;
-          uint8_t t = vram[offset] - RAM_TILES_COUNT; // equiv. GetTile(tx, ty)
+          uint16_t offset = vramOffset(screenToWorldX(tx), ty);
+          uint8_t t = vramTile(offset); // equiv. GetTile(tx, ty)
           if (isTreasure(t)) {
-            vram[offset] += TREASURE_TO_SKY_OFFSET;   // equiv. SetTile(tx, ty, ...
+            collectTreasure(offset, tx, ty);          // equiv. SetTile(tx, ty, ...
             treasureCollected++;
           } else if (isFire(t)) {
             if (overlap(sprites[i].x, sprites[i].y, TILE_WIDTH, TILE_HEIGHT,
@@ -1379,10 +5243,10 @@ int main()
                         TILE_WIDTH - 2, 2))
               killedByFire = true;
           }
-          t = vram[offset + 1] - RAM_TILES_COUNT;         // equiv. GetTile(tx + 1, ty)
+          t = vramTile(vramRight(offset));  // equiv. GetTile(tx + 1, ty)
           if (nx) {
             if (isTreasure(t)) {
-              vram[offset + 1] += TREASURE_TO_SKY_OFFSET; // equiv. SetTile(tx + 1, ty, ...
+              collectTreasure(vramRight(offset), tx + 1, ty); // equiv. SetTile(tx + 1, ty, ...
               treasureCollected++;
             } else if (isFire(t)) {
               if (overlap(sprites[i].x, sprites[i].y, TILE_WIDTH, TILE_HEIGHT,
@@ -1392,10 +5256,10 @@ int main()
                 killedByFire = true;
             }
           }
-          t = vram[offset + SCREEN_TILES_H] - RAM_TILES_COUNT;         // equiv. GetTile(tx, ty + 1)
+          t = vramTile(vramDown(offset));         // equiv. GetTile(tx, ty + 1)
           if (ny) {
             if (isTreasure(t)) {
-              vram[offset + SCREEN_TILES_H] += TREASURE_TO_SKY_OFFSET; // equiv. SetTile(tx, ty + 1, ...
+              collectTreasure(vramDown(offset), tx, ty + 1); // equiv. SetTile(tx, ty + 1, ...
               treasureCollected++;
             } else if (isFire(t)) {
               if (overlap(sprites[i].x, sprites[i].y, TILE_WIDTH, TILE_HEIGHT,
@@ -1405,10 +5269,10 @@ int main()
                 killedByFire = true;
             }
           }
-          t = vram[offset + SCREEN_TILES_H + 1] - RAM_TILES_COUNT;         // equiv. GetTile(tx + 1, ty + 1)
+          t = vramTile(vramRight(vramDown(offset)));         // equiv. GetTile(tx + 1, ty + 1)
           if (nx && ny) {
             if (isTreasure(t)) {
-              vram[offset + SCREEN_TILES_H + 1] += TREASURE_TO_SKY_OFFSET; // equiv. SetTile(tx + 1, ty + 1, ...
+              collectTreasure(vramRight(vramDown(offset)), tx + 1, ty + 1); // equiv. SetTile(tx + 1, ty + 1, ...
               treasureCollected++;
             } else if (isFire(t)) {
               if (overlap(sprites[i].x, sprites[i].y, TILE_WIDTH, TILE_HEIGHT,
@@ -1419,15 +5283,16 @@ int main()
             }
           }
           if (treasureCollected) {
+            Particles_burst(e->x, e->y, 2);
             TriggerFx(2, 128, true);
             treasuresLeft -= treasureCollected;
+            Trace_event2(TRACE_PICKUP, i, treasuresLeft);
             BCD_addConstant(&levelScore[SCORE_DIGITS * i], SCORE_DIGITS, treasureCollected * COLLECT_TREASURE_POINTS);
+            Tasks_post(TASK_SCORE);
 
             // Check to see if the last treasure has just been collected
-            if (treasuresLeft == 0) {
-              entityInitialXY(levelOffset, 0, &tx, &ty);
-              show_exit_sign(tx, ty - 1);
-            }
+            if (treasuresLeft == 0)
+              ShowExitSign(levelOffset);
           }
           if (killedByFire && !e->invincible)
             e->dead = true;
@@ -1439,24 +5304,31 @@ int main()
           bool overlapsPortal = false;
           for (uint8_t i = 0; i < PLAYERS; ++i) {
             ENTITY* e = (ENTITY*)&player[i];
-            if (!e->dead && overlap(sprites[i].x, sprites[i].y, TILE_WIDTH, TILE_HEIGHT,
-                                    sprites[PLAYERS].x, sprites[PLAYERS].y, 2 * TILE_WIDTH, 2 * TILE_HEIGHT))
+            if (e->interacts && !e->dead && overlap(sprites[i].x, sprites[i].y, TILE_WIDTH, TILE_HEIGHT, // the ghost never interacts
+                                    sprites[EXIT_SIGN_SPRITE].x, sprites[EXIT_SIGN_SPRITE].y, 2 * TILE_WIDTH, 2 * TILE_HEIGHT))
               overlapsPortal = true;
           }
           if (overlapsPortal) {
             // Ensure players can't die while the physics engine keeps running
             for (uint8_t i = 0; i < PLAYERS; ++i) {
               ENTITY* e = (ENTITY*)&player[i];
+              if (e->interacts && !e->dead)
+                Particles_burst(e->x, e->y, 8);
               e->interacts = false;
               e->invincible = true;
             }
 
+            if ((gameType & GFLAG_1P) && !(gameType & GFLAG_ENDLESS)) { // gameScore still holds the score from the start of the level
+              SaveLevelRecord(currentLevel, levelFrames,
+                              BCD_toBinary(levelScore, SCORE_DIGITS) - BCD_toBinary(gameScore, SCORE_DIGITS) + BCD_toBinary(timer, TIMER_DIGITS));
+#if (GHOST_RUNS == 1)
+              Ghost_end(levelFrames);
+#endif // GHOST_RUNS
+            }
 
             BCD_copy(gameScore, levelScore, SCORE_DIGITS * PLAYERS);
-            BCD_addBCD(&gameScore[0], SCORE_DIGITS, timer, TIMER_DIGITS); // add time bonus
-#if (PLAYERS == 2)
-            BCD_addBCD(&gameScore[SCORE_DIGITS], SCORE_DIGITS, timer, TIMER_DIGITS); // add time bonus
-#endif // (PLAYERS == 2)
+            for (uint8_t i = 0; i < PLAYERS; ++i)
+              BCD_addBCD(&gameScore[SCORE_DIGITS * i], SCORE_DIGITS, timer, TIMER_DIGITS); // add time bonus
               
 
             BCD_zero(timer, TIMER_DIGITS);
@@ -1471,12 +5343,28 @@ int main()
             SaveHighScore(gameScore);
           for (uint8_t i = 0; i < MAX_SPRITES; ++i)
             sprites[i].x = OFF_SCREEN;
-          if (++currentLevel == LEVELS)
+#if (LEVEL_GENERATOR == 1)
+          if (gameType & GFLAG_ENDLESS) {
+            endlessSeed = Generator_next(endlessSeed);
+            if (currentLevel < 99) // the level number display has 2 digits
+              ++currentLevel;
+          } else
+#endif // LEVEL_GENERATOR
+          if ((currentLevel += levelSpan) == numLevels())
             currentLevel = 0;
           break; // since levelEndTimer is not zero (this is a legit level complete, not a skip), the instant fade out at the top of the for loop will be skipped
         }
       }
 
+      FRAME_PHASE(PHASE_COLLIDE);
+
+#if (PARTICLES == 1)
+      PROFILE_BEGIN(particleStart);
+      Particles_update(player, monster, treasuresLeft == 0);
+      PROFILE_END(PROFILE_PARTICLES, particleStart);
+      FRAME_PHASE(PHASE_RENDER);
+#endif // PARTICLES
+
       // Check for level select buttons (hold select, and press a left or right shoulder button)
       uint16_t held = player[0].buttons.held;
       uint16_t pressed = player[0].buttons.pressed;
@@ -1486,12 +5374,20 @@ int main()
           if (gameType & GFLAG_1P)
             BCD_zero(gameScore, SCORE_DIGITS * PLAYERS);
           if (--currentLevel == 0)
-            currentLevel = LEVELS - 2;
+            currentLevel = numLevels() - 2;
+#if (WIDE_LEVELS == 1) || (ROOM_LEVELS == 1)
+          while (levelTheme(currentLevel) & LEVEL_CONTINUED) // skip back to the first screen of a wide level, or the first room
+            --currentLevel;
+#endif // WIDE_LEVELS || ROOM_LEVELS
           break; // load previous level
         } else if (pressed & BTN_SR) {
           if (gameType & GFLAG_1P)
             BCD_zero(gameScore, SCORE_DIGITS * PLAYERS);
-          if (++currentLevel == LEVELS - 1)
+#if (LEVEL_GENERATOR == 1)
+          if (gameType & GFLAG_ENDLESS)
+            endlessSeed = Generator_next(endlessSeed); // skip to a different generated level
+#endif // LEVEL_GENERATOR
+          if ((currentLevel += levelSpan) == numLevels() - 1)
             currentLevel = 1;
 /* __asm__ __volatile__ ("wdr"); */
           break; // load next level
@@ -1504,14 +5400,14 @@ int main()
       if (gameType & GFLAG_1P) {
         // Check for level restart button
         if (pressed & BTN_START) {
-          if (currentLevel == LEVELS - 1) // victory level
+          if (currentLevel == victoryLevel(gameType)) // victory level
             goto title_screen;
           else
             break; // restart level
         }
       } else {
         // Stop showing the victory level when any player presses START
-        if ((currentLevel == LEVELS - 1) && ((pressed & BTN_START) || (player[PLAYERS - 1].buttons.pressed & BTN_START)))
+        if ((currentLevel == victoryLevel(gameType)) && ((pressed & BTN_START) || (player[PLAYERS - 1].buttons.pressed & BTN_START)))
           goto title_screen;
         
         // Check for both players holding level restart button at the same time
@@ -1526,11 +5422,16 @@ int main()
           if (e->dead && (e->render == null_render) && (player[i].buttons.held && (player[i].buttons.held & ~BTN_START))) {
             // Respawning in multiplayer mode resets your score for that level
             BCD_copy(&levelScore[SCORE_DIGITS * i], &gameScore[SCORE_DIGITS * i], SCORE_DIGITS); 
-            spawnPlayer((PLAYER*)e, levelOffset, i, gameType);
+            Tasks_post(TASK_SCORE);
+            spawnPlayer((PLAYER*)e, levelOffset, &levelHeader, i, gameType);
           }
         }
       }
 
+#if (DEBUG_OVERLAY == 1)
+      DebugOverlay_draw();
+#endif // DEBUG_OVERLAY
+
 /* __asm__ __volatile__ ("wdr"); */
 
     }
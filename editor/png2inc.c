@@ -91,6 +91,15 @@ char outputFileName[FILENAME_LEN] = {0};
 #define DEFAULT_INPUT_DIRECTORY "levels"
 char inputDirectory[FILENAME_LEN] = {0};
 
+// When true, base maps are stored using RowDeltaRLE_compress instead of as a raw bit array
+bool compressMaps = false;
+
+// Where the .script file of each level is read from, which is the input directory unless -s is given
+char scriptDirectory[FILENAME_LEN] = ".";
+
+#define SCREEN_TILES_H 30
+#define SCREEN_TILES_V 28
+
 struct PIXEL_DATA;
 typedef struct PIXEL_DATA PIXEL_DATA;
 struct PIXEL_DATA {
@@ -309,6 +318,46 @@ uint8_t Packed5Bit_read(const uint8_t* packed, const uint16_t position)
   return value;
 }
 
+// Compresses a SCREEN_TILES_H x SCREEN_TILES_V base map bit array, and returns the number of bytes written to 'out'.
+// Each bit is XORed with the bit above it, and the runs of the resulting bits are written as nibbles (high nibble
+// first). A nibble of 15 is a run of 15 that continues the current value, and a nibble n in 0-14 is a run of n
+// followed by a toggle of the current value. The decoder (DecodeMap in bugz.c) stops once every tile is filled.
+// In the worst case, 'out' needs to hold (tiles + 1) / 2 bytes.
+uint16_t RowDeltaRLE_compress(const uint8_t* map, const uint16_t tilesH, const uint16_t tilesV, uint8_t* out)
+{
+  uint16_t nibbles = 0;
+  uint16_t run = 0;
+  bool value = false;
+  const uint16_t tiles = tilesH * tilesV;
+
+  for (uint16_t i = 0; i <= tiles; ++i) {
+    bool bit = false;
+    if (i < tiles)
+      bit = BitArray_readBit(map, i) ^ ((i >= tilesH) ? BitArray_readBit(map, i - tilesH) : false);
+
+    if (i < tiles && bit == value) {
+      run++;
+      continue;
+    }
+
+    // Flush the current run
+    while (run >= 15) {
+      out[nibbles >> 1] = (nibbles & 1) ? ((out[nibbles >> 1] & 0xF0) | 15) : (15 << 4);
+      nibbles++;
+      run -= 15;
+    }
+    if (i < tiles || run > 0) { // the final toggle is never read, so skip it unless it carries a partial run
+      out[nibbles >> 1] = (nibbles & 1) ? ((out[nibbles >> 1] & 0xF0) | run) : (run << 4);
+      nibbles++;
+    }
+
+    value = bit;
+    run = 1;
+  }
+
+  return (nibbles + 1) >> 1;
+}
+
 int decode_png(char* pngfile, uint8_t* buffer, size_t bufferlen, uint32_t* w, uint32_t* h)
 {
   printf("Opening: \"%s\"\n", pngfile);
@@ -493,6 +542,302 @@ enum FIRE_STATE {
   FIRE_STARTED = 1,
 };
 
+#define SCRIPT_SUFFIX ".script"
+#define SCRIPT_THREADS 4        // must match SCRIPT_THREADS in bugz.c
+#define SCRIPT_MONSTERS 6       // must match MAX_MONSTERS in bugz.c
+#define SCRIPT_MAX_CODE (255 - 1 - SCRIPT_THREADS) // the size of a script is one byte, and counts the threads and their entries too
+#define SCRIPT_MAX_LABELS 32
+#define SCRIPT_TOKEN_LEN 32
+#define SCRIPT_LINE_LEN 256
+
+struct SCRIPT_OP_INFO;
+typedef struct SCRIPT_OP_INFO SCRIPT_OP_INFO;
+
+struct SCRIPT_OP_INFO {
+  const char* mnemonic;
+  const char* name;
+  uint8_t operands;
+};
+
+// Indexed by SCRIPT_OP, and must match it and scriptOperands in bugz.c
+const SCRIPT_OP_INFO scriptOps[] = {
+  { "end", "SCRIPT_END", 0 },
+  { "wait", "SCRIPT_WAIT", 1 },                     // frames
+  { "wait_treasures", "SCRIPT_WAIT_TREASURES", 1 }, // n
+  { "wait_clear", "SCRIPT_WAIT_CLEAR", 1 },         // mask
+  { "spawn", "SCRIPT_SPAWN", 1 },                   // mask
+  { "hide", "SCRIPT_HIDE", 1 },                     // mask
+  { "jump", "SCRIPT_JUMP", 1 },                     // label
+  { "fire", "SCRIPT_FIRE", 3 },                     // y x1 x2
+  { "douse", "SCRIPT_DOUSE", 3 },                   // y x1 x2
+  { "tiles", "SCRIPT_TILES", 4 },                   // y x1 x2 tile
+};
+
+enum SCRIPT_OP_INDEX {
+  SCRIPT_OP_END = 0,
+  SCRIPT_OP_WAIT = 1,
+  SCRIPT_OP_WAIT_TREASURES = 2,
+  SCRIPT_OP_WAIT_CLEAR = 3,
+  SCRIPT_OP_SPAWN = 4,
+  SCRIPT_OP_HIDE = 5,
+  SCRIPT_OP_JUMP = 6,
+  SCRIPT_OP_FIRE = 7,
+  SCRIPT_OP_DOUSE = 8,
+  SCRIPT_OP_TILES = 9,
+};
+
+struct SCRIPT_LABEL;
+typedef struct SCRIPT_LABEL SCRIPT_LABEL;
+
+struct SCRIPT_LABEL {
+  char name[SCRIPT_TOKEN_LEN];
+  uint16_t address;
+};
+
+// Parses a whole token as a number, in decimal, or in hex with a 0x prefix
+bool Script_number(const char* token, long* value)
+{
+  char* end;
+  *value = strtol(token, &end, 0);
+  return (*token != '\0') && (*end == '\0');
+}
+
+// Given the name of a level's PNG file, writes the name of the script next to it (0020-test_level.xcf.png -> 0020-test_level.script)
+void Script_fileName(const char* pngFile, char* scriptFile, size_t len)
+{
+  size_t baseLen = strlen(pngFile) - 4; // ".png"
+  if ((baseLen >= 4) && (strncmp(pngFile + baseLen - 4, ".xcf", 4) == 0))
+    baseLen -= 4;
+  snprintf(scriptFile, len, "%s/%.*s%s", scriptDirectory, (int)baseLen, pngFile, SCRIPT_SUFFIX);
+}
+
+/*
+ * Script_assemble
+ *
+ * Assembles the script of a level from its text source, and appends it to
+ * level_scripts.inc, as the level number, the size of what follows, the
+ * number of threads and the entry point of each, and then the code.
+ *
+ * Each line holds one instruction, a label ("name:"), or "thread", which
+ * starts a thread at the instruction that follows. Everything after a '#'
+ * is a comment. The instructions are:
+ *
+ *   end                     ends the thread
+ *   wait frames             sleeps for 1-255 frames
+ *   wait_treasures n        waits until at least n treasures have been collected
+ *   wait_clear mask         waits until every monster in the mask is dead
+ *   spawn mask              brings back each monster in the mask that is dead
+ *   hide mask               takes each monster in the mask out of the level
+ *   jump label              continues at a label
+ *   fire y x1 x2            lights the sky tiles from (x1, y) to (x2, y)
+ *   douse y x1 x2           puts out the fire tiles from (x1, y) to (x2, y)
+ *   tiles y x1 x2 tile      sets the tiles from (x1, y) to (x2, y), where tile
+ *                           is a number, or a name from entity.h such as
+ *                           FIRST_SKY_TILE
+ *
+ * Bit i of a mask is monster i, in the order the level's header lists them.
+ * If no "thread" comes before the first instruction, a thread starts there.
+ * A thread that runs off the end of the code ends, since an end is added to
+ * code that does not finish with one, or with a jump.
+ *
+ * scriptFile [in]
+ *   The text source of the script
+ *
+ * level [in]
+ *   The number of the level the script belongs to
+ *
+ * fp [out]
+ *   level_scripts.inc
+ *
+ * Returns:
+ *   0 if the script was assembled, 1 if there is no script, or -1 on an error
+ */
+int Script_assemble(const char* scriptFile, const uint8_t level, FILE* fp)
+{
+  FILE* fpScript = fopen(scriptFile, "r");
+  if (!fpScript)
+    return 1;
+
+  static uint8_t op[SCRIPT_MAX_CODE];
+  static char operand[SCRIPT_MAX_CODE][4][SCRIPT_TOKEN_LEN];
+  static char source[SCRIPT_MAX_CODE][SCRIPT_LINE_LEN];
+  static uint16_t sourceLine[SCRIPT_MAX_CODE];
+  SCRIPT_LABEL label[SCRIPT_MAX_LABELS];
+  uint8_t entry[SCRIPT_THREADS];
+  uint8_t instructions = 0;
+  uint8_t labels = 0;
+  uint8_t threads = 0;
+  uint16_t size = 0;
+  bool threadPending = true; // the first instruction starts a thread, unless a "thread" already did
+  bool threadLine = false;
+  int retval = 0;
+
+  if (level == 0xFF) {
+    fprintf(stderr, "%s: Error: level 255 cannot have a script, since 0xFF ends the scripts\n", scriptFile);
+    retval = -1;
+    goto cleanup;
+  }
+
+  char line[SCRIPT_LINE_LEN];
+  for (uint16_t lineNumber = 1; fgets(line, sizeof(line), fpScript); ++lineNumber) {
+    char* comment = strchr(line, '#');
+    if (comment)
+      *comment = '\0';
+    char text[SCRIPT_LINE_LEN];
+    strcpy(text, line);
+    for (size_t len = strlen(text); len > 0 && strchr(" \t\r\n", text[len - 1]); --len)
+      text[len - 1] = '\0';
+
+    char* token[6];
+    uint8_t tokens = 0;
+    for (char* t = strtok(line, " \t\r\n,"); t && tokens < NELEMS(token); t = strtok(NULL, " \t\r\n,"))
+      token[tokens++] = t;
+    if (tokens == 0)
+      continue;
+
+    // A label names the address of the next instruction
+    size_t tokenLen = strlen(token[0]);
+    if (token[0][tokenLen - 1] == ':') {
+      token[0][tokenLen - 1] = '\0';
+      if (tokens != 1 || tokenLen == 1 || tokenLen > SCRIPT_TOKEN_LEN || labels == SCRIPT_MAX_LABELS) {
+        fprintf(stderr, "%s:%u: Error: bad label, or more than %d labels\n", scriptFile, lineNumber, SCRIPT_MAX_LABELS);
+        retval = -1;
+        goto cleanup;
+      }
+      for (uint8_t i = 0; i < labels; ++i) {
+        if (strcmp(label[i].name, token[0]) == 0) {
+          fprintf(stderr, "%s:%u: Error: label \"%s\" is already defined\n", scriptFile, lineNumber, token[0]);
+          retval = -1;
+          goto cleanup;
+        }
+      }
+      strcpy(label[labels].name, token[0]);
+      label[labels++].address = size;
+      continue;
+    }
+
+    if (strcmp(token[0], "thread") == 0) {
+      if (tokens != 1 || (threadPending && (threads != 0 || threadLine)) || (!threadPending && threads == SCRIPT_THREADS)) {
+        fprintf(stderr, "%s:%u: Error: empty thread, or more than %d threads\n", scriptFile, lineNumber, SCRIPT_THREADS);
+        retval = -1;
+        goto cleanup;
+      }
+      threadPending = threadLine = true;
+      continue;
+    }
+
+    uint8_t o;
+    for (o = 0; o < NELEMS(scriptOps); ++o)
+      if (strcmp(token[0], scriptOps[o].mnemonic) == 0)
+        break;
+    if (o == NELEMS(scriptOps)) {
+      fprintf(stderr, "%s:%u: Error: unknown instruction \"%s\"\n", scriptFile, lineNumber, token[0]);
+      retval = -1;
+      goto cleanup;
+    }
+    if (tokens != 1 + scriptOps[o].operands) {
+      fprintf(stderr, "%s:%u: Error: \"%s\" takes %d operands\n", scriptFile, lineNumber, token[0], scriptOps[o].operands);
+      retval = -1;
+      goto cleanup;
+    }
+
+    // Check the operands that can be checked here, the names of tiles are left for the compiler to check
+    long value[4] = {0};
+    bool valid = true;
+    for (uint8_t i = 0; i < scriptOps[o].operands; ++i) {
+      const bool isName = (o == SCRIPT_OP_JUMP) || (o == SCRIPT_OP_TILES && i == 3);
+      if (strlen(token[1 + i]) >= SCRIPT_TOKEN_LEN)
+        valid = false;
+      else if (!Script_number(token[1 + i], &value[i]))
+        valid = valid && isName;
+      else if (value[i] < 0 || value[i] > 255 || o == SCRIPT_OP_JUMP)
+        valid = false;
+    }
+    if (o == SCRIPT_OP_WAIT && value[0] == 0)
+      valid = false;
+    else if ((o >= SCRIPT_OP_WAIT_CLEAR) && (o <= SCRIPT_OP_HIDE) && value[0] >= (1 << SCRIPT_MONSTERS))
+      valid = false;
+    else if ((o >= SCRIPT_OP_FIRE) && ((value[0] < 2) || (value[0] >= SCREEN_TILES_V) || (value[1] > value[2]) || (value[2] >= SCREEN_TILES_H)))
+      valid = false; // the top two rows are the score display
+    if (!valid) {
+      fprintf(stderr, "%s:%u: Error: bad operand for \"%s\"\n", scriptFile, lineNumber, token[0]);
+      retval = -1;
+      goto cleanup;
+    }
+
+    if (size + 1 + scriptOps[o].operands >= SCRIPT_MAX_CODE) { // leave room for an end
+      fprintf(stderr, "%s:%u: Error: the code is longer than %d bytes\n", scriptFile, lineNumber, SCRIPT_MAX_CODE - 1);
+      retval = -1;
+      goto cleanup;
+    }
+
+    if (threadPending) {
+      if (threads == SCRIPT_THREADS) {
+        fprintf(stderr, "%s:%u: Error: more than %d threads\n", scriptFile, lineNumber, SCRIPT_THREADS);
+        retval = -1;
+        goto cleanup;
+      }
+      entry[threads++] = size;
+      threadPending = false;
+    }
+    op[instructions] = o;
+    for (uint8_t i = 0; i < scriptOps[o].operands; ++i)
+      strcpy(operand[instructions][i], token[1 + i]);
+    strcpy(source[instructions], text + strspn(text, " \t"));
+    sourceLine[instructions] = lineNumber;
+    size += 1 + scriptOps[o].operands;
+    instructions++;
+  }
+
+  if (instructions == 0 || threadPending) {
+    fprintf(stderr, "%s: Error: a thread has no instructions\n", scriptFile);
+    retval = -1;
+    goto cleanup;
+  }
+  if (op[instructions - 1] != SCRIPT_OP_END && op[instructions - 1] != SCRIPT_OP_JUMP) {
+    op[instructions] = SCRIPT_OP_END;
+    strcpy(source[instructions], "end (added)");
+    sourceLine[instructions] = 0;
+    size++;
+    instructions++;
+  }
+
+  // Labels can be used before they are defined, so jumps are resolved once every label is known
+  for (uint8_t i = 0; i < instructions; ++i) {
+    if (op[i] != SCRIPT_OP_JUMP)
+      continue;
+    uint8_t l;
+    for (l = 0; l < labels; ++l)
+      if (strcmp(label[l].name, operand[i][0]) == 0)
+        break;
+    if (l == labels || label[l].address >= size) {
+      fprintf(stderr, "%s:%u: Error: no instruction at label \"%s\"\n", scriptFile, sourceLine[i], operand[i][0]);
+      retval = -1;
+      goto cleanup;
+    }
+    sprintf(operand[i][0], "%u", label[l].address);
+  }
+
+  fprintf(fp, "  %u, %u, %u,", level, 1 + threads + size, threads);
+  for (uint8_t i = 0; i < threads; ++i)
+    fprintf(fp, " %u,", entry[i]);
+  const char* name = strrchr(scriptFile, '/');
+  fprintf(fp, " // %s\n", name ? name + 1 : scriptFile);
+  uint16_t address = 0;
+  for (uint8_t i = 0; i < instructions; ++i) {
+    fprintf(fp, "  %s,", scriptOps[op[i]].name);
+    for (uint8_t j = 0; j < scriptOps[op[i]].operands; ++j)
+      fprintf(fp, " %s,", operand[i][j]);
+    fprintf(fp, " // %u: %s\n", address, source[i]);
+    address += 1 + scriptOps[op[i]].operands;
+  }
+  printf("  script: %u bytes, %u threads\n", 1 + threads + size, threads);
+
+ cleanup:
+  fclose(fpScript);
+  return retval;
+}
+
 int addDirectory(char *directory) {
   // Change into the directory specified as an argument
   if (chdir(directory) < 0) {
@@ -524,8 +869,10 @@ int addDirectory(char *directory) {
 
   int retval = 0;
 
-#define SCREEN_TILES_H 30
-#define SCREEN_TILES_V 28
+// Size of the hand-written header (data/levels/*.inc) that precedes each level's generated data, must match LEVEL_HEADER in bugz.c
+#define LEVEL_HEADER_SIZE 23
+// The treasure, oneway, ladder, and fire counts
+#define LEVEL_COUNTS_SIZE 4
 
   size_t bufferlen = SCREEN_TILES_H * (SCREEN_TILES_V + 1) * 3;
   uint8_t* map_buffer = malloc(bufferlen);
@@ -534,10 +881,20 @@ int addDirectory(char *directory) {
   uint8_t* packedCoordinates = 0;
 
   uint16_t levelSize[256] = {0};
+  uint32_t totalMapBytes = 0;
+  uint32_t totalCompressedMapBytes = 0;
 
   // The total number of levels, which at the end needs to get written to its own .inc file and included in entity.h
   uint8_t totalLevels = 0;
 
+  // The scripts of every level go into one file, which bugz.c includes in the definition of levelScripts
+  FILE* fpScripts = fopen("level_scripts.inc", "w");
+  if (!fpScripts) {
+    fprintf(stderr, "Error: Unable to open \"level_scripts.inc\" for writing.");
+    retval = -1;
+    goto cleanup;
+  }
+
 #define LADDERS_SUFFIX "-ladders.png"
 #define ENTITIES_SUFFIX "-entities.png"
 
@@ -751,7 +1108,7 @@ int addDirectory(char *directory) {
         }
       }
 
-      // The level size is 168 + packedCoordinateBytes
+      // The level size is LEVEL_HEADER_SIZE + LEVEL_COUNTS_SIZE + packedCoordinateBytes + mapBytes, where mapBytes is 105 unless the map is compressed
 
       // This is the spot where we should know exactly how many players, monsters, treasures, oneways, ladders, and fires are defined
       // and we can calculate how many bytes we need to store them as packed 5-bit values. Once we know how many bytes we need, malloc
@@ -775,7 +1132,13 @@ int addDirectory(char *directory) {
       packedCoordinates = malloc(packedCoordinateBytes);
       memset(packedCoordinates, 0, packedCoordinateBytes);
 
-      levelSize[totalLevels] = 168 + packedCoordinateBytes;
+      uint8_t compressedMap[(SCREEN_TILES_H * SCREEN_TILES_V + 1) / 2] = {0};
+      uint16_t compressedMapBytes = RowDeltaRLE_compress(map, SCREEN_TILES_H, SCREEN_TILES_V, compressedMap);
+      totalMapBytes += NELEMS(map);
+      totalCompressedMapBytes += compressedMapBytes;
+      printf("  map: %d bytes raw, %d bytes compressed\n", (int)NELEMS(map), compressedMapBytes);
+
+      levelSize[totalLevels] = LEVEL_HEADER_SIZE + LEVEL_COUNTS_SIZE + packedCoordinateBytes + (compressMaps ? compressedMapBytes : NELEMS(map));
 
       // Increment the total number of levels, so at the very end we can write out a separate .inc file that defines the number of levels
       totalLevels++;
@@ -830,10 +1193,12 @@ int addDirectory(char *directory) {
         goto cleanup;
       }
 
-      fprintf(fpInc, "  ");
-      for (uint8_t i = 0; i < NELEMS(map); ++i)
-        fprintf(fpInc, "%d,", map[i]);
-      fprintf(fpInc, " // %s\n", filename);
+      if (!compressMaps) {
+        fprintf(fpInc, "  ");
+        for (uint8_t i = 0; i < NELEMS(map); ++i)
+          fprintf(fpInc, "%d,", map[i]);
+        fprintf(fpInc, " // %s\n", filename);
+      }
 
       fprintf(fpInc, "  ");
       fprintf(fpInc, "%d, // treasures\n", treasures);
@@ -855,7 +1220,22 @@ int addDirectory(char *directory) {
         fprintf(fpInc, "%d,", packedCoordinates[i]);
       fprintf(fpInc, " // 5-bit packed coordinates\n");
 
+      // The compressed map has a variable length, so it goes last
+      if (compressMaps) {
+        fprintf(fpInc, "  ");
+        for (uint16_t i = 0; i < compressedMapBytes; ++i)
+          fprintf(fpInc, "%d,", compressedMap[i]);
+        fprintf(fpInc, " // %s (row-delta RLE)\n", filename);
+      }
+
       fclose(fpInc);
+
+      char scriptFile[FILENAME_LEN];
+      Script_fileName(filename, scriptFile, sizeof(scriptFile));
+      if (Script_assemble(scriptFile, totalLevels - 1, fpScripts) < 0) {
+        retval = -1;
+        goto cleanup;
+      }
     }
   }
 
@@ -867,8 +1247,12 @@ int addDirectory(char *directory) {
     goto cleanup;
   }
   fprintf(fpNumLevels, "#define LEVELS %d\n", totalLevels); 
+  fprintf(fpNumLevels, "#define LEVEL_MAP_COMPRESSED %d\n", compressMaps ? 1 : 0);
   fclose(fpNumLevels);
 
+  printf("\nBase maps: %u bytes raw, %u bytes compressed (%s)\n",
+         totalMapBytes, totalCompressedMapBytes, compressMaps ? "compressed maps used" : "run with -c to use compressed maps");
+
   FILE* fpLevelOffsets = fopen("level_offsets.inc", "w");
   if (!fpLevelOffsets) {
     fprintf(stderr, "Error: Unable to open \"level_offsets.inc\" for writing.");
@@ -885,6 +1269,8 @@ int addDirectory(char *directory) {
   fclose(fpLevelOffsets);
 
  cleanup:
+  if (fpScripts)
+    fclose(fpScripts);
   if (packedCoordinates)
     free(packedCoordinates);
   free(ladders_buffer);
@@ -905,7 +1291,7 @@ void printUsage(void) {
 	  "\t          to #include in the definition of a PROGMEM array."
           "\n"
           "SYNOPSIS:\n"
-          "\tpng2inc [-h] [OPTIONS] [-d input_directory]\n"
+          "\tpng2inc [-h] [OPTIONS] [-d input_directory] [-s script_directory]\n"
           "\n"
           "DESCRIPTION:\n"
           "\tThis program is designed to convert a directory of PNG files\n"
@@ -917,11 +1303,26 @@ void printUsage(void) {
           "  -h\n"
           "\tDisplay this help and exit.\n"
           "\n"
+          "  -c\n"
+          "\tStore each base map using row-delta RLE compression instead\n"
+          "\tof as a raw bit array. Defines LEVEL_MAP_COMPRESSED as 1 in\n"
+          "\tnum_levels.inc so the game decodes them.\n"
+          "\n"
           "  -d input_directory\n"
           "\tThe input directory that contains the PNG files to convert.\n"
           "\n"
           "\tDefault: %s\n"
           "\n"
+          "  -s script_directory\n"
+          "\tThe directory that contains the script of each level, named\n"
+          "\tafter the level's PNG file (0020-test_level.script for\n"
+          "\t0020-test_level.xcf.png). Every script that is found is\n"
+          "\tassembled into level_scripts.inc, which a game built with\n"
+          "\tLEVEL_SCRIPTS=1 runs. The format of a script is described\n"
+          "\tabove Script_assemble in png2inc.c.\n"
+          "\n"
+          "\tDefault: the input directory\n"
+          "\n"
           ,inputDirectory);
 }
 
@@ -984,11 +1385,14 @@ int parseArguments(int *argc, char ***argv) {
 	    sizeof(inputDirectory) - 1);
   }
 
-  while (!error && (opt = getopt(*argc, *argv, "hd:")) != -1) {
+  while (!error && (opt = getopt(*argc, *argv, "hcd:s:")) != -1) {
     switch (opt) {
     case 'h': // display help
       showHelp = 1;
       break;
+    case 'c': // compress base maps
+      compressMaps = true;
+      break;
     case 'd': // override default inputDirctory
       if (strlen(optarg) < sizeof(inputDirectory)) {
         strncpy(inputDirectory, optarg, sizeof(inputDirectory) - 1);
@@ -998,6 +1402,24 @@ int parseArguments(int *argc, char ***argv) {
         error = 1;
       }
       break;
+    case 's': // read the scripts from somewhere other than inputDirectory
+      // addDirectory changes into inputDirectory, so a relative path is made absolute first
+      if ((optarg[0] == '/') || (optarg[0] == '\\') || (optarg[0] != '\0' && optarg[1] == ':')) {
+        scriptDirectory[0] = '\0';
+      } else if (!getcwd(scriptDirectory, sizeof(scriptDirectory))) {
+        perror("getcwd");
+        error = 1;
+        break;
+      } else {
+        strcat(scriptDirectory, "/");
+      }
+      if (strlen(scriptDirectory) + strlen(optarg) < sizeof(scriptDirectory)) {
+        strcat(scriptDirectory, optarg);
+      } else {
+        fprintf(stderr, "Error: scriptDirectory too long\n");
+        error = 1;
+      }
+      break;
     default:
       error = 1;
       break;
@@ -0,0 +1,391 @@
+/*
+
+  tracedump.c
+
+  This program decodes the binary trace that a Bugz build made with
+  TRACE=1 writes to the uzem console, and prints a timeline of each
+  frame and a histogram of how long each phase of a frame took. It can
+  also report each level, and fail when a level has too many frames
+  that began late or took too long to load.
+
+  This file is part of Bugz.
+
+  Bugz is free software: you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Bugz is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+  License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Bugz.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define NELEMS(x) (sizeof(x)/sizeof(x[0]))
+
+// These must match enum TRACE_EVENT and enum FRAME_PHASE in bugz.c
+#define TRACE_FRAME  0xF0 // frame LO8, frame HI8, vsyncs since the previous frame began
+#define TRACE_PHASE  0xF1 // frame LO8, phase, ticks / 2 since vsync
+#define TRACE_SPAWN  0xF2 // frame LO8, sprite
+#define TRACE_KILL   0xF3 // frame LO8, sprite
+#define TRACE_PICKUP 0xF4 // frame LO8, player, treasures left
+#define TRACE_LEVEL  0xF5 // frame LO8, level, ticks / 2 since vsync
+#define TRACE_LOADED 0xF6 // frame LO8, vsyncs since the level began loading, ticks / 2 since vsync
+
+// Length of each record, including the event byte
+const uint8_t recordLength[] = { 4, 4, 3, 3, 4, 4, 4 };
+
+const char phaseNames[] = { 'I', 'U', 'R', 'C', 'H', 'L' };
+#define PHASES_N NELEMS(phaseNames)
+
+#define CYCLES_PER_UNIT 2048     // the game writes timer 0 ticks of 1024 cycles divided by 2
+#define CYCLES_PER_SCANLINE 1820
+#define UNITS_PER_FRAME 233      // 262 scanlines
+#define BUCKET_SCANLINES 8
+#define BUCKETS 33               // the last bucket holds everything from a full frame up
+#define BAR_WIDTH 50
+#define MAX_LOADS 256
+
+bool printTimeline = false;
+bool printLevels = false;
+bool stopAtWrap = false;          // stop reading once a level loads whose number is less than the one before it
+int32_t maxLate = -1;             // most frames on a level that may begin late, or -1 for any number
+int32_t maxLoadScanlines = -1;    // most scanlines a level may take to load, or -1 for any number
+const char* inputFileName = NULL;
+
+uint32_t histogram[PHASES_N][BUCKETS];
+uint32_t phaseFrames[PHASES_N];   // frames each phase ran in
+uint64_t phaseUnits[PHASES_N];    // total time of each phase
+uint32_t phaseWorst[PHASES_N];    // most time a phase took in one frame
+
+uint32_t frameUnits[PHASES_N];    // time each phase has taken so far in this frame
+bool frameRan[PHASES_N];
+int32_t frameNumber = -1;         // -1 until the first TRACE_FRAME is seen
+uint8_t frameLastTime;            // time of the previous phase record in this frame
+
+uint8_t loadLevel[MAX_LOADS];     // level loaded, in the order they were loaded
+uint32_t loadUnits[MAX_LOADS];    // how long each load took, before the level faded in
+uint32_t loadFrames[MAX_LOADS];   // frames played on each load of a level
+uint32_t loadLate[MAX_LOADS];     // frames on each load of a level that began late
+uint32_t loadWorst[MAX_LOADS];    // most time any frame on each load of a level took
+uint32_t loads;
+uint8_t loadStartTime;            // time of the TRACE_LEVEL record of the load in progress
+bool loading;                     // the next frame to begin is the first one of a level
+
+uint32_t frames, overruns, skippedBytes, mismatches;
+bool wrapped;
+uint8_t wrapLevel;                // the level whose load ended the pass, when wrapped
+
+static uint32_t toScanlines(const uint32_t units)
+{
+  return (units * CYCLES_PER_UNIT + CYCLES_PER_SCANLINE / 2) / CYCLES_PER_SCANLINE;
+}
+
+// Adds the time each phase took in the frame that just ended to the histograms
+static void endFrame(void)
+{
+  uint32_t total = 0;
+  for (uint8_t p = 0; p < PHASES_N; ++p)
+    total += frameUnits[p];
+  if (loads > 0 && total > loadWorst[loads - 1])
+    loadWorst[loads - 1] = total;
+
+  for (uint8_t p = 0; p < PHASES_N; ++p) {
+    if (!frameRan[p])
+      continue;
+    uint32_t bucket = toScanlines(frameUnits[p]) / BUCKET_SCANLINES;
+    if (bucket >= BUCKETS)
+      bucket = BUCKETS - 1;
+    ++histogram[p][bucket];
+    ++phaseFrames[p];
+    phaseUnits[p] += frameUnits[p];
+    if (frameUnits[p] > phaseWorst[p])
+      phaseWorst[p] = frameUnits[p];
+  }
+  memset(frameUnits, 0, sizeof(frameUnits));
+  memset(frameRan, 0, sizeof(frameRan));
+  frameLastTime = 0; // the timer restarts at vsync, and the first phase is charged for the kernel's vsync work too
+}
+
+static void decodeRecord(const uint8_t* r)
+{
+  if (r[0] == TRACE_FRAME) {
+    if (frameNumber >= 0)
+      endFrame();
+    frameNumber = r[1] | (r[2] << 8);
+    ++frames;
+    const bool late = (r[3] > 1) && !loading; // the first frame of a level begins after it loads and fades in
+    if (late)
+      ++overruns;
+    if (loads > 0) { // frames of the level that loaded last
+      ++loadFrames[loads - 1];
+      if (late)
+        ++loadLate[loads - 1];
+    }
+    loading = false;
+    if (printTimeline)
+      printf("\n%5d%s", frameNumber, late ? "*" : " ");
+    return;
+  }
+
+  if (frameNumber >= 0 && r[1] != (frameNumber & 0xFF))
+    ++mismatches;
+
+  switch (r[0]) {
+  case TRACE_PHASE:
+    if (frameNumber >= 0 && r[2] < PHASES_N) { // phases outside of a frame are part of a load
+      // A frame that is still running at the next vsync sees the timer restart
+      const uint32_t units = (r[3] >= frameLastTime) ? r[3] - frameLastTime : r[3] + UNITS_PER_FRAME - frameLastTime;
+      frameUnits[r[2]] += units;
+      frameRan[r[2]] = true;
+      frameLastTime = r[3];
+      if (printTimeline)
+        printf(" %c%u", phaseNames[r[2]], toScanlines(r[3]));
+    }
+    break;
+  case TRACE_SPAWN:
+    if (printTimeline)
+      printf(" +%u", r[2]);
+    break;
+  case TRACE_KILL:
+    if (printTimeline)
+      printf(" x%u", r[2]);
+    break;
+  case TRACE_PICKUP:
+    if (printTimeline)
+      printf(" $%u(%u left)", r[2], r[3]);
+    break;
+  case TRACE_LEVEL:
+    if (frameNumber >= 0)
+      endFrame();
+    if (stopAtWrap && loads > 0 && r[2] < loadLevel[loads - 1]) {
+      wrapped = true;
+      wrapLevel = r[2];
+      frameNumber = -1;
+      break;
+    }
+    if (printTimeline)
+      printf("\n----- level %u -----", r[2]);
+    frameNumber = -1; // until the level's first frame begins, what follows is the load
+    loading = true;
+    loadStartTime = r[3];
+    if (loads < MAX_LOADS)
+      loadLevel[loads] = r[2];
+    break;
+  case TRACE_LOADED:
+    if (loading && loads < MAX_LOADS) {
+      loadUnits[loads] = r[2] * UNITS_PER_FRAME + r[3] - loadStartTime;
+      if (printTimeline)
+        printf(" loaded in %u scanlines", toScanlines(loadUnits[loads]));
+      ++loads;
+    }
+    break;
+  }
+}
+
+// Prints each load of a level, and returns false if any of them went over the limits, or if the levels were not all played
+static bool printLevelReport(void)
+{
+  if (loads == 0) {
+    printf("\nFAIL: no level was loaded\n");
+    return false;
+  }
+
+  bool pass = true;
+  printf("\nLevel   load  frames    late  worst (scanlines)\n");
+  for (uint32_t i = 0; i < loads; ++i) {
+    const uint32_t loadScanlines = toScanlines(loadUnits[i]);
+    const bool tooLate = (maxLate >= 0) && (loadLate[i] > (uint32_t)maxLate);
+    const bool tooSlow = (maxLoadScanlines >= 0) && (loadScanlines > (uint32_t)maxLoadScanlines);
+    printf("  %3u %6u %7u %7u %6u%s%s\n", loadLevel[i], loadScanlines, loadFrames[i], loadLate[i],
+           toScanlines(loadWorst[i]), tooLate ? "  FAIL: too many late frames" : "", tooSlow ? "  FAIL: slow load" : "");
+    if (tooLate || tooSlow)
+      pass = false;
+  }
+  // The script skips from the last level back to level 1, so ending anywhere else means levels were missed
+  if (stopAtWrap && !wrapped) {
+    printf("FAIL: the trace ended after level %u, before the levels wrapped around\n", loadLevel[loads - 1]);
+    pass = false;
+  } else if (stopAtWrap && wrapLevel != 1) {
+    printf("FAIL: level %u loaded after level %u, so the game ended before the last level\n", wrapLevel, loadLevel[loads - 1]);
+    pass = false;
+  }
+  printf("%s\n", pass ? "PASS" : "FAIL");
+  return pass;
+}
+
+static void printHistograms(void)
+{
+  printf("\n%u frames, %u began late, %u bytes skipped, %u frame numbers did not match\n",
+         frames, overruns, skippedBytes, mismatches);
+
+  if (loads)
+    printf("\nLevel loads (scanlines):\n");
+  for (uint32_t i = 0; i < loads; ++i)
+    printf("  level %3u  %u\n", loadLevel[i], toScanlines(loadUnits[i]));
+
+  for (uint8_t p = 0; p < PHASES_N; ++p) {
+    if (phaseFrames[p] == 0)
+      continue;
+    uint32_t most = 0;
+    for (uint8_t b = 0; b < BUCKETS; ++b)
+      if (histogram[p][b] > most)
+        most = histogram[p][b];
+
+    printf("\nPhase %c: %u frames, mean %.1f scanlines, worst %u scanlines\n",
+           phaseNames[p], phaseFrames[p],
+           (double)phaseUnits[p] * CYCLES_PER_UNIT / CYCLES_PER_SCANLINE / phaseFrames[p],
+           toScanlines(phaseWorst[p]));
+    for (uint8_t b = 0; b < BUCKETS; ++b) {
+      if (histogram[p][b] == 0)
+        continue;
+      if (b == BUCKETS - 1)
+        printf("  %3u+     ", b * BUCKET_SCANLINES);
+      else
+        printf("  %3u-%-3u  ", b * BUCKET_SCANLINES, b * BUCKET_SCANLINES + BUCKET_SCANLINES - 1);
+      const uint32_t width = (histogram[p][b] * BAR_WIDTH + most - 1) / most;
+      for (uint32_t i = 0; i < width; ++i)
+        putchar('#');
+      printf(" %u\n", histogram[p][b]);
+    }
+  }
+}
+
+void printUsage(void) {
+  fprintf(stderr, "\n"
+          "NAME:\n"
+          "\ttracedump - decode the trace written by a TRACE=1 build\n"
+          "\n"
+          "SYNOPSIS:\n"
+          "\ttracedump [-h] [-t] [-l] [-p] [-m late_frames] [-M scanlines] [trace_file]\n"
+          "\n"
+          "DESCRIPTION:\n"
+          "\tReads what the uzem wrote to the console while running a\n"
+          "\tbuild made with TRACE=1 (from stdin if no file is given),\n"
+          "\tskips any text, and prints a histogram of the scanlines each\n"
+          "\tphase of a frame took per frame: Input, Update, Render,\n"
+          "\tCollisions, HUD, and Loading, along with how long\n"
+          "\teach level took to load.\n"
+          "\n"
+          "OPTIONS:\n"
+          "  -h\n"
+          "\tDisplay this help and exit.\n"
+          "\n"
+          "  -t\n"
+          "\tAlso print a timeline with one line per frame. Each line has\n"
+          "\tthe frame number (marked with a * if the frame began late),\n"
+          "\tthen the scanline each phase ended on, such as U40, and the\n"
+          "\tevents: +sprite for a spawn, xsprite for a kill, and\n"
+          "\t$player(treasures left) for a pickup.\n"
+          "\n"
+          "  -l\n"
+          "\tAlso print a report with one line per level loaded: the\n"
+          "\tscanlines it took to load, the frames played on it, how many\n"
+          "\tof them began late, and the scanlines of the longest frame,\n"
+          "\tthen PASS or FAIL. It fails if no level was loaded.\n"
+          "\n"
+          "  -p\n"
+          "\tStop once the levels wrap around, when a level loads whose\n"
+          "\tnumber is less than the one before it. Piping the uzem into\n"
+          "\ttracedump -p stops the uzem after one pass through the levels.\n"
+          "\tThe level report then fails if the trace ended before the\n"
+          "\tlevels wrapped around, or if they wrapped around to any level\n"
+          "\tbut 1, such as the title screen after the game ended, since\n"
+          "\tthen the levels were not all played.\n"
+          "\n"
+          "  -m late_frames\n"
+          "\tFail if more than late_frames frames on any level began late.\n"
+          "\n"
+          "  -M scanlines\n"
+          "\tFail if any level took more than scanlines scanlines to load.\n"
+          "\n"
+          "EXIT STATUS:\n"
+          "\t0 if no limit was exceeded, 2 if one was, or if the level\n"
+          "\treport found that levels were missed.\n"
+          "\n");
+}
+
+int parseArguments(int argc, char *argv[]) {
+  int opt;
+  while ((opt = getopt(argc, argv, "htlpm:M:")) != -1) {
+    switch (opt) {
+    case 't': // print the timeline
+      printTimeline = true;
+      break;
+    case 'l': // print the level report
+      printLevels = true;
+      break;
+    case 'p': // stop after one pass through the levels
+      stopAtWrap = true;
+      break;
+    case 'm': // most late frames per level
+      maxLate = atoi(optarg);
+      printLevels = true;
+      break;
+    case 'M': // most scanlines per load
+      maxLoadScanlines = atoi(optarg);
+      printLevels = true;
+      break;
+    case 'h': // display help
+      printUsage();
+      return 1;
+    default:
+      return -1;
+    }
+  }
+
+  if (optind + 1 < argc) {
+    fprintf(stderr, "Error: too many arguments\n");
+    return -1;
+  }
+  if (optind < argc)
+    inputFileName = argv[optind];
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  int retVal = parseArguments(argc, argv);
+  if (retVal != 0)
+    return retVal;
+
+  FILE* in = stdin;
+  if (inputFileName && !(in = fopen(inputFileName, "rb"))) {
+    fprintf(stderr, "Error: Unable to open \"%s\"\n", inputFileName);
+    return -1;
+  }
+
+  uint8_t record[4];
+  int c;
+  while (!wrapped && (c = fgetc(in)) != EOF) {
+    if (c < TRACE_FRAME || c > TRACE_LOADED) { // the uzem's own messages, or the other debug builds' output
+      ++skippedBytes;
+      continue;
+    }
+    record[0] = c;
+    const uint8_t length = recordLength[c - TRACE_FRAME];
+    if (fread(&record[1], 1, length - 1, in) != (size_t)(length - 1))
+      break;
+    decodeRecord(record);
+  }
+  if (frameNumber >= 0)
+    endFrame();
+
+  if (in != stdin)
+    fclose(in);
+
+  printHistograms();
+  if (printLevels && !printLevelReport())
+    return 2;
+  return 0;
+}
@@ -53,6 +53,132 @@
 void null_input(ENTITY* const e) { (void)e; }
 void null_render(ENTITY* const e) { sprites[e->tag].x = OFF_SCREEN; }
 
+#if (PERF_COUNTERS == 1)
+uint16_t perfCounters[PERF_COUNTERS_N];
+#endif // PERF_COUNTERS
+
+#if (WIDE_LEVELS == 1)
+uint8_t levelTilesH = SCREEN_TILES_H;
+uint8_t cameraX;
+
+uint8_t screenPixelX(const int16_t p)
+{
+  int16_t x = nearestScreenPixel(p) - cameraX * TILE_WIDTH;
+  if (x < 0 || x > (SCREEN_TILES_H - 1) * TILE_WIDTH) // sprites are hidden instead of being clipped at the edges of the camera
+    return OFF_SCREEN;
+  return x;
+}
+#endif // WIDE_LEVELS
+
+#if (ROOM_LEVELS == 1)
+uint8_t roomExits;
+#endif // ROOM_LEVELS
+
+#if (MOVING_PLATFORMS == 1)
+ENTITY* platforms[MAX_PLATFORMS];
+int16_t platformFrom[MAX_PLATFORMS][2];
+uint8_t platformCount;
+
+/*
+ * platform_carry
+ *
+ * Moves a rider by how far the platform it is standing on moved this
+ * frame, and then tests it against vram again, since a platform can
+ * move it into a solid tile
+ *
+ * e [in/out]
+ *   The rider
+ *
+ * dx [in]
+ *   How far the platform moved horizontally
+ *
+ * Returns:
+ *   false if a solid tile above the rider pushed it off the platform
+ */
+static bool platform_carry(ENTITY* const e, const int16_t dx)
+{
+  e->x += dx;
+  if (e->x > ENTITY_MAX_X)
+    e->x = ENTITY_MAX_X;
+  else if (e->x < 0)
+    e->x = 0;
+
+  // The same tests as the collision detection for X in entity_update, with dx standing in for the entity's own velocity
+  const uint8_t tx = p2ht(e->x);
+  const bool nx = (bool)nh(e->x);
+  const uint8_t ty = p2vt(e->y);
+  const bool ny = (bool)nv(e->y);
+  uint16_t offset = vramOffset(tx, ty);
+  bool cell      = isSolid(vramTile(offset                     ));
+  bool cellright = isSolid(vramTile(vramRight(offset)          ));
+  const bool celldown  = isSolid(vramTile(vramDown(offset)           ));
+  const bool celldiag  = isSolid(vramTile(vramRight(vramDown(offset))));
+  if (dx > 0) {
+    if ((nx && cellright && !cell) || (ny && celldiag && !celldown))
+      e->x = ht2p(tx);
+  } else if (dx < 0) {
+    if ((nx && cell && !cellright) || (ny && celldown && !celldiag))
+      e->x = ht2p(tx + 1);
+  }
+
+  // A platform that rises into a solid tile leaves its rider below the tile, to fall off of it
+  offset = vramOffset(p2ht(e->x), ty);
+  cell = isSolid(vramTile(offset));
+  cellright = nh(e->x) && isSolid(vramTile(vramRight(offset)));
+  if (cell || cellright) {
+    e->y = vt2p(ty + 1);
+    return false;
+  }
+  return true;
+}
+
+/*
+ * platform_land
+ *
+ * Tests a falling (or standing) entity against each platform, after the
+ * collision tests against vram, and lands it on the first one whose top
+ * its feet were above, or just inside of, before this frame's movement
+ *
+ * e [in/out]
+ *   The entity, which is carried along by how far the platform it lands
+ *   on moved this frame
+ *
+ * prevY [in]
+ *   The Y of the entity before this frame's movement
+ *
+ * Returns:
+ *   true if the entity is standing on a platform
+ *
+ * Note: Every platform has already moved this frame (see platformFrom),
+ *       so its movement is where it is less where it was.
+ */
+static bool platform_land(ENTITY* const e, const int16_t prevY)
+{
+  if (e->dy < 0 || platformCount == 0)
+    return false;
+  bool landed = false;
+  Profile_platformBegin();
+  for (uint8_t i = 0; i < platformCount; ++i) {
+    const ENTITY* const p = platforms[i];
+    const int16_t fromY = platformFrom[i][1];
+    if ((uint16_t)(e->x - p->x + (WORLD_METER - 1)) < (2 * WORLD_METER - 1) && // within WORLD_METER horizontally
+        (prevY + WORLD_METER <= fromY + (WORLD_METER / 2)) &&                   // a platform that moved up still catches it
+        (e->y + WORLD_METER >= ((p->y < fromY) ? p->y : fromY))) {             // and so does one that moved down
+      e->y = p->y - WORLD_METER;
+      e->dy = 0;
+      e->jumping = false;
+      e->framesFalling = 0;
+      landed = platform_carry(e, p->x - platformFrom[i][0]);
+      break;
+    }
+  }
+  Profile_platformEnd();
+  return landed;
+}
+#else // MOVING_PLATFORMS
+#define platform_land(e, prevY) false
+#endif // MOVING_PLATFORMS
+
 void entity_init(ENTITY* const e, void (*input)(ENTITY*), void (*update)(ENTITY*), void (*render)(ENTITY*), const uint8_t tag, const uint8_t x, const uint8_t y, const int16_t maxdx, const int16_t impulse)
 {
   memset(e, 0, sizeof(ENTITY));
@@ -74,7 +200,7 @@ void entity_init(ENTITY* const e, void (*input)(ENTITY*), void (*update)(ENTITY*
 __attribute__(( always_inline ))
 static inline bool isSolidForEntity(const uint16_t offset, const uint8_t ty, const int16_t prevY, const uint8_t entityHeight, const bool down)
 {
-  uint8_t t = vram[offset] - RAM_TILES_COUNT; // equiv. GetTile(tx, ty)
+  uint8_t t = vramTile(offset); // equiv. GetTile(tx, ty)
   // One-way tiles are only solid for Y collisions where your previous Y puts your feet above the tile, and you're not currently pressing down
   return (isSolid(t) || (isOneWay(t) && !down && ((prevY + entityHeight - 1) < vt2p(ty))));
 }
@@ -90,14 +216,14 @@ void ai_walk_until_blocked(ENTITY* const e)
   uint8_t ty = p2vt(e->y);
 
   if (e->left) {
-    uint16_t offset = ty * SCREEN_TILES_H + tx;
-    if ((e->x == 0) || isSolid(vram[offset] - RAM_TILES_COUNT)) { // cell, equiv. GetTile(tx, ty)
+    uint16_t offset = vramOffset(tx, ty);
+    if ((e->x == 0) || isSolid(vramTile(offset))) { // cell, equiv. GetTile(tx, ty)
       e->left = false;
       e->right = true;
     }
   } else if (e->right) {
-    uint16_t offset = ty * SCREEN_TILES_H + tx + 1;
-    if ((tx == SCREEN_TILES_H - 1) || isSolid(vram[offset] - RAM_TILES_COUNT)) { // cellright, equiv. GetTile(tx + 1, ty)
+    uint16_t offset = vramRight(vramOffset(tx, ty));
+    if ((tx == LEVEL_TILES_H - 1) || isSolid(vramTile(offset))) { // cellright, equiv. GetTile(tx + 1, ty)
       e->right = false;
       e->left = true;
     }
@@ -120,18 +246,18 @@ void ai_walk_until_blocked_or_ledge(ENTITY* const e)
     tx = p2ht(e->x);
   uint8_t ty = p2vt(e->y);
 
-  uint16_t offset = ty * SCREEN_TILES_H + tx;
+  uint16_t offset = vramOffset(tx, ty);
   if (e->left) {
     if ((e->x == 0) || !(e->falling ||
-                         isSolidForEntity(offset + SCREEN_TILES_H, ty + 1, e->y, WORLD_METER, e->down)) || // celldown, equiv. tx, ty + 1
-        isSolid(vram[offset] - RAM_TILES_COUNT)) {                                                         // cell,     equiv. tx, ty
+                         isSolidForEntity(vramDown(offset), ty + 1, e->y, WORLD_METER, e->down)) || // celldown, equiv. tx, ty + 1
+        isSolid(vramTile(offset))) {                                           // cell,     equiv. tx, ty
       e->left = false;
       e->right = true;
     }
   } else if (e->right) {
-    if ((tx == SCREEN_TILES_H - 1) || !(e->falling ||
-                                        isSolidForEntity(offset + SCREEN_TILES_H + 1, ty + 1, e->y, WORLD_METER, e->down)) || // celldiag,  equiv. tx + 1, ty + 1
-        isSolid(vram[offset + 1] - RAM_TILES_COUNT)) {                                                                        // cellright, equiv. tx + 1, ty
+    if ((tx == LEVEL_TILES_H - 1) || !(e->falling ||
+                                       isSolidForEntity(vramRight(vramDown(offset)), ty + 1, e->y, WORLD_METER, e->down)) || // celldiag,  equiv. tx + 1, ty + 1
+        isSolid(vramTile(vramRight(offset)))) {                                                              // cellright, equiv. tx + 1, ty
       e->right = false;
       e->left = true;
     }
@@ -254,15 +380,15 @@ static void ai_fly_circle(ENTITY* const e, const bool clockwise)
   e->framesFalling++;
 
   // Clamp X to within screen bounds
-  if (e->x > ((SCREEN_TILES_H - 1) * (TILE_WIDTH << FP_SHIFT))) {
-    e->x = ((SCREEN_TILES_H - 1) * (TILE_WIDTH << FP_SHIFT));
+  if (e->x > ENTITY_MAX_X) {
+    e->x = ENTITY_MAX_X;
   } else if (e->x < 0) {
     e->x = 0;
   }
 
   // Clamp Y to within screen bounds
-  if (e->y > ((SCREEN_TILES_V - 1) * (TILE_HEIGHT << FP_SHIFT))) {
-    e->y = ((SCREEN_TILES_V - 1) * (TILE_HEIGHT << FP_SHIFT));
+  if (e->y > ENTITY_MAX_Y) {
+    e->y = ENTITY_MAX_Y;
   } else if (e->y < 0) {
     e->y = 0;
   }
@@ -326,8 +452,8 @@ void player_update(ENTITY* const e)
   }
 
   // Clamp X to within screen bounds
-  if (e->x > ((SCREEN_TILES_H - 1) * (TILE_WIDTH << FP_SHIFT))) {
-    e->x = ((SCREEN_TILES_H - 1) * (TILE_WIDTH << FP_SHIFT));
+  if (e->x > ENTITY_MAX_X) {
+    e->x = ENTITY_MAX_X;
     e->dx = 0;
   } else if (e->x < 0) {
     e->x = 0;
@@ -343,11 +469,11 @@ void player_update(ENTITY* const e)
   bool nx = (bool)nh(e->x); // true if entity overlaps right
   uint8_t ty = p2vt(e->y);
   bool ny = (bool)nv(e->y); // true if entity overlaps below
-  uint16_t offset = ty * SCREEN_TILES_H + tx;
-  bool cell      = isSolid(vram[offset                     ] - RAM_TILES_COUNT); // equiv. GetTile(tx,     ty    )
-  bool cellright = isSolid(vram[offset + 1                 ] - RAM_TILES_COUNT); // equiv. GetTile(tx + 1, ty    )
-  bool celldown  = isSolid(vram[offset + SCREEN_TILES_H    ] - RAM_TILES_COUNT); // equiv. GetTile(tx,     ty + 1)
-  bool celldiag  = isSolid(vram[offset + SCREEN_TILES_H + 1] - RAM_TILES_COUNT); // equiv. GetTile(tx + 1, ty + 1)
+  uint16_t offset = vramOffset(tx, ty);
+  bool cell      = isSolid(vramTile(offset                     )); // equiv. GetTile(tx,     ty    )
+  bool cellright = isSolid(vramTile(vramRight(offset)          )); // equiv. GetTile(tx + 1, ty    )
+  bool celldown  = isSolid(vramTile(vramDown(offset)           )); // equiv. GetTile(tx,     ty + 1)
+  bool celldiag  = isSolid(vramTile(vramRight(vramDown(offset)))); // equiv. GetTile(tx + 1, ty + 1)
 
   if (e->dx > 0) {
     if ((nx && cellright && !cell) || // nx check avoids potential glitch when moving off ladder
@@ -399,16 +525,17 @@ void player_update(ENTITY* const e)
     e->dy = WORLD_MAXDY;
 
   // Clamp Y to within screen bounds
-  if (e->y > ((SCREEN_TILES_V - 1) * (TILE_HEIGHT << FP_SHIFT))) {
-    e->y = ((SCREEN_TILES_V - 1) * (TILE_HEIGHT << FP_SHIFT));
+  if (e->y > ENTITY_MAX_Y) {
+    e->y = ENTITY_MAX_Y;
     e->dy = 0;
-    // Kill the entity if it would have fallen through the bottom of the screen
-    if (!e->invincible)
+    // Kill the entity if it would have fallen through the bottom of the screen, unless there is a room below it
+    if (!e->invincible && !(roomExits & ROOM_EDGE_DOWN))
       e->dead = true;
     return;
   } else if (e->y < 0) {
     e->y = 0;
-    e->dy = 0;
+    if (!(roomExits & ROOM_EDGE_UP)) // keep the momentum of a jump that carries the entity into the room above
+      e->dy = 0;
   }
 
   // Collision Detection for Y (uses rounded X so if it looks like the entity should fall through a one-tile-wide hole, it will)
@@ -416,11 +543,11 @@ void player_update(ENTITY* const e)
   tx = p2ht(roundedX);
   nx = (bool)nh(roundedX);  // true if entity overlaps right
   ty = p2vt(e->y);
-  offset = ty * SCREEN_TILES_H + tx;
+  offset = vramOffset(tx, ty);
   cell      = isSolidForEntity(offset,                      ty,     prevY, WORLD_METER, e->down); // equiv. ... tx,     ty
-  cellright = isSolidForEntity(offset + 1,                  ty,     prevY, WORLD_METER, e->down); // equiv. ... tx + 1, ty
-  celldown  = isSolidForEntity(offset + SCREEN_TILES_H,     ty + 1, prevY, WORLD_METER, e->down); // equiv. ... tx,     ty + 1
-  celldiag  = isSolidForEntity(offset + SCREEN_TILES_H + 1, ty + 1, prevY, WORLD_METER, e->down); // equiv. ... tx + 1, ty + 1
+  cellright = isSolidForEntity(vramRight(offset),           ty,     prevY, WORLD_METER, e->down); // equiv. ... tx + 1, ty
+  celldown  = isSolidForEntity(vramDown(offset),            ty + 1, prevY, WORLD_METER, e->down); // equiv. ... tx,     ty + 1
+  celldiag  = isSolidForEntity(vramRight(vramDown(offset)), ty + 1, prevY, WORLD_METER, e->down); // equiv. ... tx + 1, ty + 1
 
   if (e->dy > 0) {
     if ((      celldown && !cell) ||
@@ -438,7 +565,8 @@ void player_update(ENTITY* const e)
     }
   }
 
-  e->falling = !(celldown || (nx && celldiag)) && !e->jumping; // detect if we're now falling or not
+  const bool platform = platform_land(e, prevY);
+  e->falling = !(celldown || (nx && celldiag) || platform) && !e->jumping; // detect if we're now falling or not
   if (e->falling && e->framesFalling <= WORLD_FALLING_GRACE_FRAMES)
     e->framesFalling++;
 
@@ -452,11 +580,11 @@ void player_update(ENTITY* const e)
       ny = (bool)nv(e->y - 1); // true if entity overlaps above
     }
     
-    uint16_t offset = ty * SCREEN_TILES_H + tx;
-    if ((            isLadder(vram[offset                     ] - RAM_TILES_COUNT)) || // cell,      equiv. ... GetTile(tx,     ty    ) ...
-        (nx &&       isLadder(vram[offset + 1                 ] - RAM_TILES_COUNT)) || // cellright, equiv. ... GetTile(tx + 1, ty    ) ...
-        (ny &&       isLadder(vram[offset + SCREEN_TILES_H    ] - RAM_TILES_COUNT)) || // celldown,  equiv. ... GetTile(tx,     ty + 1) ...
-        (nx && ny && isLadder(vram[offset + SCREEN_TILES_H + 1] - RAM_TILES_COUNT))) { // celldiag,  equiv. ... GetTile(tx + 1, ty + 1) ...
+    uint16_t offset = vramOffset(tx, ty);
+    if ((            isLadder(vramTile(offset                     ))) || // cell,      equiv. ... GetTile(tx,     ty    ) ...
+        (nx &&       isLadder(vramTile(vramRight(offset)          ))) || // cellright, equiv. ... GetTile(tx + 1, ty    ) ...
+        (ny &&       isLadder(vramTile(vramDown(offset)           ))) || // celldown,  equiv. ... GetTile(tx,     ty + 1) ...
+        (nx && ny && isLadder(vramTile(vramRight(vramDown(offset)))))) { // celldiag,  equiv. ... GetTile(tx + 1, ty + 1) ...
       if (e->down)
         e->y++; // allow entity to join a ladder directly below them
       else // e->up
@@ -501,8 +629,8 @@ void entity_update(ENTITY* const e)
     e->dx = e->maxdx;
 
   // Clamp X to within screen bounds
-  if (e->x > ((SCREEN_TILES_H - 1) * (TILE_WIDTH << FP_SHIFT))) {
-    e->x = ((SCREEN_TILES_H - 1) * (TILE_WIDTH << FP_SHIFT));
+  if (e->x > ENTITY_MAX_X) {
+    e->x = ENTITY_MAX_X;
     e->dx = 0;
   } else if (e->x < 0) {
     e->x = 0;
@@ -517,11 +645,11 @@ void entity_update(ENTITY* const e)
   uint8_t tx = p2ht(e->x);
   uint8_t ty = p2vt(e->y);
   bool ny = (bool)nv(e->y); // true if entity overlaps below
-  uint16_t offset = ty * SCREEN_TILES_H + tx;
-  bool cell      = isSolid(vram[offset                     ] - RAM_TILES_COUNT); // equiv. GetTile(tx,     ty    )
-  bool cellright = isSolid(vram[offset + 1                 ] - RAM_TILES_COUNT); // equiv. GetTile(tx + 1, ty    )
-  bool celldown  = isSolid(vram[offset + SCREEN_TILES_H    ] - RAM_TILES_COUNT); // equiv. GetTile(tx,     ty + 1)
-  bool celldiag  = isSolid(vram[offset + SCREEN_TILES_H + 1] - RAM_TILES_COUNT); // equiv. GetTile(tx + 1, ty + 1)
+  uint16_t offset = vramOffset(tx, ty);
+  bool cell      = isSolid(vramTile(offset                     )); // equiv. GetTile(tx,     ty    )
+  bool cellright = isSolid(vramTile(vramRight(offset)          )); // equiv. GetTile(tx + 1, ty    )
+  bool celldown  = isSolid(vramTile(vramDown(offset)           )); // equiv. GetTile(tx,     ty + 1)
+  bool celldiag  = isSolid(vramTile(vramRight(vramDown(offset)))); // equiv. GetTile(tx + 1, ty + 1)
 
   if (e->dx > 0) {
     if ((      cellright && !cell) ||
@@ -555,8 +683,8 @@ void entity_update(ENTITY* const e)
     e->dy = WORLD_MAXDY;
 
   // Clamp Y to within screen bounds
-  if (e->y > ((SCREEN_TILES_V - 1) * (TILE_HEIGHT << FP_SHIFT))) {
-    e->y = ((SCREEN_TILES_V - 1) * (TILE_HEIGHT << FP_SHIFT));
+  if (e->y > ENTITY_MAX_Y) {
+    e->y = ENTITY_MAX_Y;
     e->dy = 0;
     // Kill the entity if it would have fallen through the bottom of the screen
     if (!e->invincible)
@@ -573,11 +701,11 @@ void entity_update(ENTITY* const e)
   tx = p2ht(roundedX);
   ty = p2vt(e->y);
   bool nx = (bool)nh(roundedX);  // true if entity overlaps right
-  offset = ty * SCREEN_TILES_H + tx;
+  offset = vramOffset(tx, ty);
   cell      = isSolidForEntity(offset,                      ty,     prevY, WORLD_METER, false); // equiv. ... tx,     ty
-  cellright = isSolidForEntity(offset + 1,                  ty,     prevY, WORLD_METER, false); // equiv. ... tx + 1, ty
-  celldown  = isSolidForEntity(offset + SCREEN_TILES_H,     ty + 1, prevY, WORLD_METER, false); // equiv. ... tx,     ty + 1
-  celldiag  = isSolidForEntity(offset + SCREEN_TILES_H + 1, ty + 1, prevY, WORLD_METER, false); // equiv. ... tx + 1, ty + 1
+  cellright = isSolidForEntity(vramRight(offset),           ty,     prevY, WORLD_METER, false); // equiv. ... tx + 1, ty
+  celldown  = isSolidForEntity(vramDown(offset),            ty + 1, prevY, WORLD_METER, false); // equiv. ... tx,     ty + 1
+  celldiag  = isSolidForEntity(vramRight(vramDown(offset)), ty + 1, prevY, WORLD_METER, false); // equiv. ... tx + 1, ty + 1
 
   if (e->dy > 0) {
     if ((      celldown && !cell) ||
@@ -594,7 +722,8 @@ void entity_update(ENTITY* const e)
     }
   }
 
-  e->falling = !(celldown || (nx && celldiag)) && !e->jumping; // detect if we're now falling or not
+  const bool platform = platform_land(e, prevY);
+  e->falling = !(celldown || (nx && celldiag) || platform) && !e->jumping; // detect if we're now falling or not
 
 /* __asm__ __volatile__ ("wdr"); */
 }
@@ -619,8 +748,8 @@ void entity_update_dying(ENTITY* const e)
   // When dying, we can only decelerate, so it is safe to skip the bounds check for dx
 
   // Clamp X to within screen bounds
-  if (e->x > ((SCREEN_TILES_H - 1) * (TILE_WIDTH << FP_SHIFT))) {
-    e->x = ((SCREEN_TILES_H - 1) * (TILE_WIDTH << FP_SHIFT));
+  if (e->x > ENTITY_MAX_X) {
+    e->x = ENTITY_MAX_X;
     e->dx = 0;
   } else if (e->x < 0) {
     e->x = 0;
@@ -644,8 +773,8 @@ void entity_update_dying(ENTITY* const e)
     e->dy = WORLD_MAXDY;
 
   // Clamp Y to within screen bounds
-  if (e->y > ((SCREEN_TILES_V - 1) * (TILE_HEIGHT << FP_SHIFT))) {
-    e->y = ((SCREEN_TILES_V - 1) * (TILE_HEIGHT << FP_SHIFT));
+  if (e->y > ENTITY_MAX_Y) {
+    e->y = ENTITY_MAX_Y;
     e->dy = 0;
     e->visible = false; // we hit the bottom of the screen, so now hide the entity
   } else if (e->y < 0) {
@@ -693,8 +822,8 @@ void entity_update_flying(ENTITY* const e)
       e->dx = 0; // clamp at zero to prevent friction from making the entity jiggle side to side
 
     // Clamp X to within screen bounds
-    if (e->x > ((SCREEN_TILES_H - 1) * (TILE_WIDTH << FP_SHIFT))) {
-      e->x = ((SCREEN_TILES_H - 1) * (TILE_WIDTH << FP_SHIFT));
+    if (e->x > ENTITY_MAX_X) {
+      e->x = ENTITY_MAX_X;
       e->dx = 0;
     } else if (e->x < 0) {
       e->x = 0;
@@ -737,8 +866,8 @@ void entity_update_flying(ENTITY* const e)
       e->dy = 0; // clamp at zero to prevent friction from making the entity jiggle up and down
 
     // Clamp Y to within screen bounds
-    if (e->y > ((SCREEN_TILES_V - 1) * (TILE_HEIGHT << FP_SHIFT))) {
-      e->y = ((SCREEN_TILES_V - 1) * (TILE_HEIGHT << FP_SHIFT));
+    if (e->y > ENTITY_MAX_Y) {
+      e->y = ENTITY_MAX_Y;
       e->dy = 0;
       //TriggerFx(3, 128, true); // uncomment this line to debug level designs, will make a sound if the entity clips
     } else if (e->y < 0) {
@@ -760,11 +889,11 @@ void entity_update_ladder(ENTITY* const e)
   bool ny = (bool)nv(e->y); // true if entity overlaps below
 
   // Check to see if the entity has left the ladder
-  uint16_t offset = ty * SCREEN_TILES_H + tx;
-  if (!(             isLadder(vram[offset                     ] - RAM_TILES_COUNT) ||   // equiv. ... GetTile(tx, ty) ..
-        (nx &&       isLadder(vram[offset + 1                 ] - RAM_TILES_COUNT)) ||  // equiv. ... GetTile(tx + 1, ty) ...
-        (ny &&       isLadder(vram[offset + SCREEN_TILES_H    ] - RAM_TILES_COUNT)) ||  // equiv. ... GetTile(tx, ty + 1) ...
-        (nx && ny && isLadder(vram[offset + SCREEN_TILES_H + 1] - RAM_TILES_COUNT)))) { // equiv. ... GetTile(tx + 1, ty + 1) ...
+  uint16_t offset = vramOffset(tx, ty);
+  if (!(             isLadder(vramTile(offset                     )) ||   // equiv. ... GetTile(tx, ty) ..
+        (nx &&       isLadder(vramTile(vramRight(offset)          ))) ||  // equiv. ... GetTile(tx + 1, ty) ...
+        (ny &&       isLadder(vramTile(vramDown(offset)           ))) ||  // equiv. ... GetTile(tx, ty + 1) ...
+        (nx && ny && isLadder(vramTile(vramRight(vramDown(offset))))))) { // equiv. ... GetTile(tx + 1, ty + 1) ...
     e->update = player_update;
     e->animationFrameCounter = 0;
     e->framesFalling = 0;   // reset the counter so a grace jump is allowed if moving off the ladder causes the entity to fall
@@ -821,7 +950,7 @@ static void generic_render(ENTITY* const e, const uint8_t animationStart)
     sprites[e->tag].flags = SPRITE_FLIP_X;
 
   // Round x and y to the nearest whole pixel for rendering purposes only
-  sprites[e->tag].x = nearestScreenPixel(e->x);
+  sprites[e->tag].x = screenPixelX(e->x);
   sprites[e->tag].y = nearestScreenPixel(e->y);
 }
 
@@ -874,7 +1003,7 @@ static void generic_flying_render(ENTITY* const e, const uint8_t animationStart)
     sprites[e->tag].flags = SPRITE_FLIP_X;
 
   // Round x and y to the nearest whole pixel for rendering purposes only
-  sprites[e->tag].x = nearestScreenPixel(e->x);
+  sprites[e->tag].x = screenPixelX(e->x);
   sprites[e->tag].y = nearestScreenPixel(e->y);
 }
 
@@ -930,7 +1059,7 @@ static void generic_spider_render(ENTITY* const e, const uint8_t animationStart)
     sprites[e->tag].flags = SPRITE_FLIP_X;
 
   // Round x and y to the nearest whole pixel for rendering purposes only
-  sprites[e->tag].x = nearestScreenPixel(e->x);
+  sprites[e->tag].x = screenPixelX(e->x);
   sprites[e->tag].y = nearestScreenPixel(e->y);
 }
 
@@ -948,6 +1077,149 @@ void alt_spider_render(ENTITY* const e)
   generic_spider_render(e, ALT_SPIDER_ANIMATION_START);
 }
 
+#if (MOVING_PLATFORMS == 1)
+#define PLATFORM_TILE 76
+
+void platform_render(ENTITY* const e)
+{
+  sprites[e->tag].tileIndex = PLATFORM_TILE;
+  sprites[e->tag].x = screenPixelX(e->x);
+  sprites[e->tag].y = nearestScreenPixel(e->y);
+}
+#endif // MOVING_PLATFORMS
+
+#if (PROJECTILES > 0)
+#define PROJECTILE_TILE 77
+#define PROJECTILE_FRAMES (2 * WORLD_FPS) // two "seconds"
+
+PROJECTILE projectiles[PROJECTILES];
+uint8_t projectileLive;
+static uint8_t projectileFree;
+
+/*
+ * projectile_reset
+ *
+ * Puts every projectile back on the free list, and hides their sprites
+ */
+void projectile_reset(void)
+{
+  projectileLive = PROJECTILE_NONE;
+  projectileFree = 0;
+  for (uint8_t i = 0; i < PROJECTILES; ++i) {
+    projectiles[i].next = (i + 1 < PROJECTILES) ? i + 1 : PROJECTILE_NONE;
+    sprites[PROJECTILE_SPRITE(i)].x = OFF_SCREEN;
+  }
+}
+
+/*
+ * projectile_spawn
+ *
+ * Takes a projectile off of the free list, and puts it at the head of
+ * the live list
+ *
+ * x, y, dx, dy [in]
+ *   The initial position and velocity, in the same units as an ENTITY
+ *
+ * owner [in]
+ *   The tag of the player that threw it
+ *
+ * Returns:
+ *   The index of the projectile, or PROJECTILE_NONE if all of them
+ *   are already in flight
+ */
+uint8_t projectile_spawn(const int16_t x, const int16_t y, const int16_t dx, const int16_t dy, const uint8_t owner)
+{
+  const uint8_t i = projectileFree;
+  if (i == PROJECTILE_NONE)
+    return i;
+  PROJECTILE* const p = &projectiles[i];
+  projectileFree = p->next;
+  p->next = projectileLive;
+  projectileLive = i;
+
+  p->x = x;
+  p->y = y;
+  p->dx = dx;
+  p->dy = dy;
+  p->owner = owner;
+  p->frames = PROJECTILE_FRAMES;
+  PERF_COUNT(PERF_SPAWN);
+  return i;
+}
+
+/*
+ * projectile_despawn
+ *
+ * Unlinks a projectile from the live list, puts it on the free list,
+ * and hides its sprite
+ *
+ * i [in]
+ *   The index of the projectile
+ *
+ * prev [in]
+ *   The index of the projectile before it in the live list, or
+ *   PROJECTILE_NONE if it is the head, which the caller already has
+ *   from walking the list
+ */
+void projectile_despawn(const uint8_t i, const uint8_t prev)
+{
+  PROJECTILE* const p = &projectiles[i];
+  if (prev == PROJECTILE_NONE)
+    projectileLive = p->next;
+  else
+    projectiles[prev].next = p->next;
+  p->next = projectileFree;
+  projectileFree = i;
+  sprites[PROJECTILE_SPRITE(i)].x = OFF_SCREEN;
+}
+
+/*
+ * projectile_update
+ *
+ * Moves a projectile along its arc, and tests the single tile under its
+ * center, instead of the four tiles that entity_update tests
+ *
+ * p [in/out]
+ *   The projectile
+ *
+ * Returns:
+ *   false if it hit a solid tile, left the level, or ran out of frames,
+ *   and should be despawned
+ */
+__attribute__((optimize("O3")))
+bool projectile_update(PROJECTILE* const p)
+{
+  if (--p->frames == 0)
+    return false;
+
+  p->x += (p->dx / WORLD_FPS);
+  p->y += (p->dy / WORLD_FPS);
+  p->dy += (WORLD_GRAVITY / WORLD_FPS);
+  if (p->dy > WORLD_MAXDY)
+    p->dy = WORLD_MAXDY;
+
+  if ((uint16_t)p->x > ENTITY_MAX_X || (uint16_t)p->y > ENTITY_MAX_Y) // also catches negative values
+    return false;
+#if (WIDE_LEVELS == 1)
+  if (screenPixelX(p->x) == OFF_SCREEN) // only the columns around the camera are in vram
+    return false;
+#endif // WIDE_LEVELS
+
+  const uint8_t tx = p2ht(p->x + (WORLD_METER / 2));
+  const uint8_t ty = p2vt(p->y + (WORLD_METER / 2));
+  return !isSolid(vramTile(vramOffset(tx, ty)));
+}
+
+void projectile_render(const uint8_t i)
+{
+  const PROJECTILE* const p = &projectiles[i];
+  sprites[PROJECTILE_SPRITE(i)].tileIndex = PROJECTILE_TILE;
+  sprites[PROJECTILE_SPRITE(i)].flags = 0;
+  sprites[PROJECTILE_SPRITE(i)].x = screenPixelX(p->x);
+  sprites[PROJECTILE_SPRITE(i)].y = nearestScreenPixel(p->y);
+}
+#endif // PROJECTILES
+
 
 // ---------- PLAYER
 
@@ -958,12 +1230,17 @@ void player_init(PLAYER* const p, void (*input)(ENTITY*), void (*update)(ENTITY*
 }
 
 void player_input(ENTITY* const e)
+{
+  player_input_buttons(e, ReadJoypad(e->tag)); // tag will be set to the index of the player, which is also the index of its controller
+}
+
+void player_input_buttons(ENTITY* const e, const uint16_t held)
 {
   PLAYER* const p = (PLAYER*)e; // upcast
 
-  // Read the current state of the player's controller
+  // Update the state of the player's controller
   p->buttons.prev = p->buttons.held;
-  p->buttons.held = ReadJoypad(e->tag); // tag will be set to 0 or 1, depending on which player we are
+  p->buttons.held = held;
   p->buttons.pressed = p->buttons.held & (p->buttons.held ^ p->buttons.prev);
   //p->buttons.released = p->buttons.prev & (p->buttons.held ^ p->buttons.prev);
 
@@ -983,9 +1260,9 @@ void player_input(ENTITY* const e)
       int16_t roundedX = nearestScreenPixel(e->x) << FP_SHIFT; // ignore subpixels for this calculation
       uint8_t tx = p2ht(roundedX);
       uint8_t ty = p2vt(e->y - 1);
-      uint16_t offset = ty * SCREEN_TILES_H + tx;
-      if (                       isSolid(vram[offset    ] - RAM_TILES_COUNT) || // cellup,     equiv. ... GetTile(tx,     ty) ...
-          ((bool)nh(roundedX) && isSolid(vram[offset + 1] - RAM_TILES_COUNT)))  // cellupdiag, equiv. ... GetTile(tx + 1, ty) ...
+      uint16_t offset = vramOffset(tx, ty);
+      if (                       isSolid(vramTile(offset           )) || // cellup,     equiv. ... GetTile(tx,     ty) ...
+          ((bool)nh(roundedX) && isSolid(vramTile(vramRight(offset)))))  // cellupdiag, equiv. ... GetTile(tx + 1, ty) ...
         e->jump = false;
     }
 
@@ -1005,38 +1282,39 @@ void player_input(ENTITY* const e)
 #define PLAYER_ANIMATION_FRAME_SKIP 4
 #define PLAYER_LADDER_ANIMATION_FRAME_SKIP 4
 #define PLAYER_NUM_SPRITES 11
+#define PLAYER_SPRITES(tag) (((tag) & 1) * PLAYER_NUM_SPRITES) // players 3 and 4 share the sprites of players 1 and 2
 const uint8_t playerAnimation[] PROGMEM = { 0, 1, 2, 1 };
 const uint8_t playerLadderAnimation[] PROGMEM = { 0, 1, 2, 1, 0, 3, 4, 3 };
 
 void player_render(ENTITY* const e)
 {
   if (e->dead) {
-    sprites[e->tag].tileIndex = PLAYER_DEAD + e->tag * PLAYER_NUM_SPRITES;
+    sprites[e->tag].tileIndex = PLAYER_DEAD + PLAYER_SPRITES(e->tag);
   } else if (e->update == entity_update_ladder) {
     if (e->up || e->down || e->left || e->right) {
       for (uint8_t i = (e->turbo ? 2 : 1); i; --i) { // turbo makes animations faster
         if ((e->animationFrameCounter % PLAYER_ANIMATION_FRAME_SKIP) == 0)
-          sprites[e->tag].tileIndex = PLAYER_LADDER_ANIMATION_START + pgm_read_byte(&playerLadderAnimation[e->animationFrameCounter / PLAYER_LADDER_ANIMATION_FRAME_SKIP]) + e->tag * PLAYER_NUM_SPRITES;
+          sprites[e->tag].tileIndex = PLAYER_LADDER_ANIMATION_START + pgm_read_byte(&playerLadderAnimation[e->animationFrameCounter / PLAYER_LADDER_ANIMATION_FRAME_SKIP]) + PLAYER_SPRITES(e->tag);
         // Compile-time assert that we are working with a power of 2
         BUILD_BUG_ON(isNotPowerOf2(PLAYER_LADDER_ANIMATION_FRAME_SKIP * NELEMS(playerLadderAnimation)));
         e->animationFrameCounter = (e->animationFrameCounter + 1) & (PLAYER_LADDER_ANIMATION_FRAME_SKIP * NELEMS(playerLadderAnimation) - 1);
       }
     } else {
-      sprites[e->tag].tileIndex = PLAYER_LADDER_ANIMATION_START + e->tag * PLAYER_NUM_SPRITES;
+      sprites[e->tag].tileIndex = PLAYER_LADDER_ANIMATION_START + PLAYER_SPRITES(e->tag);
     }
   } else {
     if (e->jumping || e->falling || e->update == entity_update_flying) {
       if (e->dy >= 0)
-        sprites[e->tag].tileIndex = PLAYER_STATIONARY + e->tag * PLAYER_NUM_SPRITES;
+        sprites[e->tag].tileIndex = PLAYER_STATIONARY + PLAYER_SPRITES(e->tag);
       else
-        sprites[e->tag].tileIndex = PLAYER_JUMP + e->tag * PLAYER_NUM_SPRITES;
+        sprites[e->tag].tileIndex = PLAYER_JUMP + PLAYER_SPRITES(e->tag);
     } else {
       if (!e->left && !e->right) {
-        sprites[e->tag].tileIndex = PLAYER_STATIONARY + e->tag * PLAYER_NUM_SPRITES;
+        sprites[e->tag].tileIndex = PLAYER_STATIONARY + PLAYER_SPRITES(e->tag);
       } else {
         for (uint8_t i = (e->turbo ? 2 : 1); i; --i) { // turbo makes animations faster
           if ((e->animationFrameCounter % PLAYER_ANIMATION_FRAME_SKIP) == 0)
-            sprites[e->tag].tileIndex = PLAYER_ANIMATION_START + pgm_read_byte(&playerAnimation[e->animationFrameCounter / PLAYER_ANIMATION_FRAME_SKIP]) + e->tag * PLAYER_NUM_SPRITES;
+            sprites[e->tag].tileIndex = PLAYER_ANIMATION_START + pgm_read_byte(&playerAnimation[e->animationFrameCounter / PLAYER_ANIMATION_FRAME_SKIP]) + PLAYER_SPRITES(e->tag);
           // Compile-time assert that we are working with a power of 2
           BUILD_BUG_ON(isNotPowerOf2(PLAYER_ANIMATION_FRAME_SKIP * NELEMS(playerAnimation)));
           e->animationFrameCounter = (e->animationFrameCounter + 1) & (PLAYER_ANIMATION_FRAME_SKIP * NELEMS(playerAnimation) - 1);
@@ -1051,7 +1329,7 @@ void player_render(ENTITY* const e)
     sprites[e->tag].flags = SPRITE_FLIP_X;
 
   // Round x and y to the nearest whole pixel for rendering purposes only
-  sprites[e->tag].x = nearestScreenPixel(e->x);
+  sprites[e->tag].x = screenPixelX(e->x);
   sprites[e->tag].y = nearestScreenPixel(e->y);
 }
 
@@ -1059,21 +1337,21 @@ void player_render(ENTITY* const e)
 
 void show_exit_sign(const uint8_t tx, const uint8_t ty)
 {
-  sprites[PLAYERS    ].tileIndex = EXIT_SIGN_START;
-  sprites[PLAYERS + 1].tileIndex = EXIT_SIGN_START + 1;
-  sprites[PLAYERS + 2].tileIndex = EXIT_SIGN_START + 2;
-  sprites[PLAYERS + 3].tileIndex = EXIT_SIGN_START + 3;
+  sprites[EXIT_SIGN_SPRITE    ].tileIndex = EXIT_SIGN_START;
+  sprites[EXIT_SIGN_SPRITE + 1].tileIndex = EXIT_SIGN_START + 1;
+  sprites[EXIT_SIGN_SPRITE + 2].tileIndex = EXIT_SIGN_START + 2;
+  sprites[EXIT_SIGN_SPRITE + 3].tileIndex = EXIT_SIGN_START + 3;
 
-  sprites[PLAYERS].flags = sprites[PLAYERS + 1].flags = sprites[PLAYERS + 2].flags = sprites[PLAYERS + 3].flags = 0;
+  sprites[EXIT_SIGN_SPRITE].flags = sprites[EXIT_SIGN_SPRITE + 1].flags = sprites[EXIT_SIGN_SPRITE + 2].flags = sprites[EXIT_SIGN_SPRITE + 3].flags = 0;
 
-  sprites[PLAYERS    ].x = sprites[PLAYERS + 2].x = (tx    ) * TILE_WIDTH;
-  sprites[PLAYERS + 1].x = sprites[PLAYERS + 3].x = (tx + 1) * TILE_WIDTH;
-  sprites[PLAYERS    ].y = sprites[PLAYERS + 1].y = (ty    ) * TILE_HEIGHT;
-  sprites[PLAYERS + 2].y = sprites[PLAYERS + 3].y = (ty + 1) * TILE_HEIGHT;
+  sprites[EXIT_SIGN_SPRITE    ].x = sprites[EXIT_SIGN_SPRITE + 2].x = (tx    ) * TILE_WIDTH;
+  sprites[EXIT_SIGN_SPRITE + 1].x = sprites[EXIT_SIGN_SPRITE + 3].x = (tx + 1) * TILE_WIDTH;
+  sprites[EXIT_SIGN_SPRITE    ].y = sprites[EXIT_SIGN_SPRITE + 1].y = (ty    ) * TILE_HEIGHT;
+  sprites[EXIT_SIGN_SPRITE + 2].y = sprites[EXIT_SIGN_SPRITE + 3].y = (ty + 1) * TILE_HEIGHT;
 }
 
 void hide_exit_sign(void)
 {
-  for (uint8_t i = PLAYERS; i < PLAYERS + 4; ++i)
+  for (uint8_t i = EXIT_SIGN_SPRITE; i < EXIT_SIGN_SPRITE + 4; ++i)
     sprites[i].x = OFF_SCREEN;
 }
@@ -42,6 +42,65 @@
 #define LO8(x) ((uint8_t)((x) & 0xFF))
 #define HI8(x) ((uint8_t)(((x) >> 8) & 0xFF))
 
+// Set to 1 for a debug build that draws CPU and stack usage bars at the right end of the score display (see DEBUG_OVERLAY in default/Makefile)
+#ifndef DEBUG_OVERLAY
+#define DEBUG_OVERLAY 0
+#endif // DEBUG_OVERLAY
+
+// Set to 1 for a debug build that writes a binary trace of the game's events to the uzem console (see TRACE in default/Makefile)
+#ifndef TRACE
+#define TRACE 0
+#endif // TRACE
+
+// Set to 1 for a debug build that counts the cycles spent in each engine function on each level (see PROFILE in default/Makefile)
+#ifndef PROFILE
+#define PROFILE 0
+#endif // PROFILE
+
+// Set to 1 for a debug build that counts how much work of each kind the game does (see PERF_COUNTERS in default/Makefile)
+#ifndef PERF_COUNTERS
+#define PERF_COUNTERS 0
+#endif // PERF_COUNTERS
+
+#if (PERF_COUNTERS == 1)
+enum PERF_COUNTER;
+typedef enum PERF_COUNTER PERF_COUNTER;
+
+// Keep in the same order as perfCounterNames in bugz.c
+enum PERF_COUNTER {
+  PERF_VRAM,    // tiles read from vram through vramTile
+  PERF_FLASH,   // calls to pgm_read_byte and pgm_read_word
+  PERF_OVERLAP, // calls to overlap
+  PERF_CALL,    // calls through an entity's input, update, or render pointer in the main loop
+  PERF_SPAWN,   // entities and projectiles spawned
+  PERF_FX,      // calls to TriggerFx
+  PERF_COUNTERS_N
+};
+
+extern uint16_t perfCounters[PERF_COUNTERS_N];
+#define PERF_COUNT(counter) (++perfCounters[counter])
+
+// Every flash read in the game goes through one of these avr-libc macros, so they are wrapped rather than each call
+#undef pgm_read_byte
+#define pgm_read_byte(address) (PERF_COUNT(PERF_FLASH), pgm_read_byte_near(address))
+#undef pgm_read_word
+#define pgm_read_word(address) (PERF_COUNT(PERF_FLASH), pgm_read_word_near(address))
+// Parenthesizing the name calls the kernel's function rather than this macro
+#define TriggerFx(patch, volume, retrig) (PERF_COUNT(PERF_FX), (TriggerFx)(patch, volume, retrig))
+#else // PERF_COUNTERS
+#define PERF_COUNT(counter) ((void)0)
+#endif // PERF_COUNTERS
+
+// Set to 1 to play the joypad input in data/input_script.inc instead of reading the controllers (see INPUT_SCRIPT in default/Makefile)
+#ifndef INPUT_SCRIPT
+#define INPUT_SCRIPT 0
+#endif // INPUT_SCRIPT
+
+#if (INPUT_SCRIPT == 1)
+unsigned int Script_joypad(const unsigned char joypadNo);
+#define ReadJoypad(joypadNo) Script_joypad(joypadNo)
+#endif // INPUT_SCRIPT
+
 #define vt2p(t) ((t) * (TILE_HEIGHT << FP_SHIFT))
 #define ht2p(t) ((t) * (TILE_WIDTH << FP_SHIFT))
 #define p2vt(p) ((p) / (TILE_HEIGHT << FP_SHIFT))
@@ -51,12 +110,102 @@
 
 #define nearestScreenPixel(p) (((p) + (1 << (FP_SHIFT - 1))) >> FP_SHIFT)
 
+// Set to 4 for four players, which needs the controllers to be read through a multitap (see PLAYERS in default/Makefile)
+#ifndef PLAYERS
 #define PLAYERS 2
+#endif // PLAYERS
 #define MONSTERS 6
 
+#if (PLAYERS != 1) && (PLAYERS != 2) && (PLAYERS != 4)
+#error PLAYERS must be 1, 2, or 4
+#endif // PLAYERS
+
+#if (PLAYERS > 2) && (INPUT_SCRIPT == 0)
+// The kernel only reads controllers 1 and 2, so controllers 3 and 4 are read through the multitaps once a frame
+unsigned int Multitap_joypad(const unsigned char joypadNo);
+#define ReadJoypad(joypadNo) Multitap_joypad(joypadNo)
+#endif // (PLAYERS > 2) && (INPUT_SCRIPT == 0)
+
+// Sprite slots are assigned in this order: the players, the four sprites of the exit sign, and then the monsters
+#define EXIT_SIGN_SPRITE PLAYERS
+#define MONSTER_SPRITE(i) (EXIT_SIGN_SPRITE + 4 + (i))
+
 // Include the auto-generated definition for LEVELS
 #include "editor/levels/num_levels.inc"
 
+// png2inc defines this as 1 when it was run with -c to store row-delta RLE base maps
+#ifndef LEVEL_MAP_COMPRESSED
+#define LEVEL_MAP_COMPRESSED 0
+#endif // LEVEL_MAP_COMPRESSED
+
+// Set to 1 to allow levels that are several screens wide and scroll horizontally (see WIDE_LEVELS in default/Makefile)
+#ifndef WIDE_LEVELS
+#define WIDE_LEVELS 0
+#endif // WIDE_LEVELS
+
+#if (WIDE_LEVELS == 1)
+#if (SCROLLING != 1)
+#error WIDE_LEVELS requires SCROLLING=1, so vram is a ring of VRAM_TILES_H columns
+#endif // SCROLLING
+// Only the visible columns, plus one on either side, are kept in vram, which wraps around every VRAM_TILES_H columns
+extern uint8_t levelTilesH; // width of the current level in tiles
+extern uint8_t cameraX;     // world column shown in the leftmost column of the screen
+#define LEVEL_TILES_H levelTilesH
+#define vramOffset(tx, ty) ((uint16_t)(ty) * VRAM_TILES_H + ((tx) & (VRAM_TILES_H - 1)))
+#define vramRight(offset) (((offset) & ~(VRAM_TILES_H - 1)) | (((offset) + 1) & (VRAM_TILES_H - 1)))
+#define vramDown(offset) ((offset) + VRAM_TILES_H)
+#define screenToWorldX(tx) (cameraX + (tx)) // also used by the score display, which shares the scrolling plane with the level
+uint8_t screenPixelX(const int16_t p); // OFF_SCREEN when the world position p is outside of the camera
+#else // WIDE_LEVELS
+#define LEVEL_TILES_H SCREEN_TILES_H
+#define vramOffset(tx, ty) ((ty) * SCREEN_TILES_H + (tx))
+#define vramRight(offset) ((offset) + 1)
+#define vramDown(offset) ((offset) + SCREEN_TILES_H)
+#define screenToWorldX(tx) (tx)
+#define screenPixelX(p) nearestScreenPixel(p)
+#endif // WIDE_LEVELS
+
+// The tile at a vram offset, as an index into the tileset, equiv. GetTile(tx, ty)
+#define vramTile(offset) (PERF_COUNT(PERF_VRAM), vram[offset] - RAM_TILES_COUNT)
+
+// Largest x an entity may have, which keeps it entirely inside of the level
+#define ENTITY_MAX_X ((LEVEL_TILES_H - 1) * (TILE_WIDTH << FP_SHIFT))
+// Largest y an entity may have, which keeps it entirely on screen
+#define ENTITY_MAX_Y ((SCREEN_TILES_V - 1) * (TILE_HEIGHT << FP_SHIFT))
+
+// Set to 1 to allow levels made of several rooms, where leaving an edge of the screen enters the neighboring room
+#ifndef ROOM_LEVELS
+#define ROOM_LEVELS 0
+#endif // ROOM_LEVELS
+
+// Edges of the screen that lead to another room
+#define ROOM_EDGE_LEFT 1
+#define ROOM_EDGE_RIGHT 2
+#define ROOM_EDGE_UP 4
+#define ROOM_EDGE_DOWN 8
+
+#if (ROOM_LEVELS == 1)
+#if (WIDE_LEVELS == 1)
+#error ROOM_LEVELS and WIDE_LEVELS cannot both be 1
+#endif // WIDE_LEVELS
+extern uint8_t roomExits; // ROOM_EDGE_* bits of the current room, which players pass through instead of stopping at
+#else // ROOM_LEVELS
+#define roomExits 0
+#endif // ROOM_LEVELS
+
+// Set to 0 to leave out moving platforms, which are monster slots that players and monsters can stand on and ride
+#ifndef MOVING_PLATFORMS
+#define MOVING_PLATFORMS 1
+#endif // MOVING_PLATFORMS
+
+// Set to how many projectiles can be in flight at once, or 0 to leave them out (see PROJECTILES in default/Makefile)
+#ifndef PROJECTILES
+#define PROJECTILES 0
+#endif // PROJECTILES
+
+// Each projectile has its own sprite slot, after the monsters
+#define PROJECTILE_SPRITE(i) (MONSTER_SPRITE(MONSTERS) + (i))
+
 // Fixed point shift
 #define FP_SHIFT 2
 
@@ -165,9 +314,23 @@
 #define isOneWay(t) (((t) >= FIRST_ABOVEGROUND_ONE_WAY_TILE) && ((t) <= LAST_SKY_LADDER_TOP_TILE))
 #define isLadder(t) ((((t) >= FIRST_UNDERGROUND_LADDER_TOP_TILE) && ((t) <= LAST_UNDERGROUND_LADDER_MIDDLE_TILE)) || (((t) >= FIRST_ABOVEGROUND_ONE_WAY_LADDER_TOP_TILE) && ((t) <= LAST_SKY_LADDER_MIDDLE_TILE)))
 
+#if (PERF_COUNTERS == 1)
+// isSolid and isLadder take vramTile(offset) and use it more than once, so evaluate it only once to count each tile read once
+static inline bool perfIsSolid(const uint8_t t) { return isSolid(t); }
+static inline bool perfIsLadder(const uint8_t t) { return isLadder(t); }
+#undef isSolid
+#undef isLadder
+#define isSolid(t) perfIsSolid(t)
+#define isLadder(t) perfIsLadder(t)
+#endif // PERF_COUNTERS
+
+#if (DEBUG_OVERLAY == 1)
+// The overlay's user RAM tiles come before every flash tile in vram, so they would otherwise read as fire
+#define isFire(t) (((t) >= FIRST_FIRE_TILE) && ((t) <= LAST_FIRE_TILE))
+#else // DEBUG_OVERLAY
 // As long as the last (non-title screen) tile is a fire tile, we can skip the '&& ((t) <= LAST_FIRE_TILE)' part of the condition
 #define isFire(t) ((t) >= FIRST_FIRE_TILE)
-//#define isFire(t) (((t) >= FIRST_FIRE_TILE) && ((t) <= LAST_FIRE_TILE))
+#endif // DEBUG_OVERLAY
 
 struct ENTITY;
 typedef struct ENTITY ENTITY;
@@ -230,6 +393,7 @@ void entity_init(ENTITY* const e, void (*input)(ENTITY*), void (*update)(ENTITY*
 void player_init(PLAYER* const p, void (*input)(ENTITY*), void (*update)(ENTITY*), void (*render)(ENTITY*), const uint8_t tag, const uint8_t x, const uint8_t y);
 
 void player_input(ENTITY* const e);
+void player_input_buttons(ENTITY* const e, const uint16_t held); // same as player_input, but the buttons come from somewhere other than a controller
 void ai_walk_until_blocked(ENTITY* const e);
 void ai_hop_until_blocked(ENTITY* const e);
 void ai_walk_until_blocked_or_ledge(ENTITY* const e);
@@ -261,6 +425,53 @@ void alt_spider_render(ENTITY* const e);
 void moth_render(ENTITY* const e);
 void butterfly_render(ENTITY* const e);
 
+#if (MOVING_PLATFORMS == 1)
+// Entities that use gravity land on the top of a platform the way they land on a one-way tile, and are carried along by it
+#define MAX_PLATFORMS 4
+extern ENTITY* platforms[MAX_PLATFORMS];
+extern int16_t platformFrom[MAX_PLATFORMS][2]; // x and y of each platform before it moved this frame
+extern uint8_t platformCount;
+void platform_render(ENTITY* const e);
+#define isPlatform(e) ((e)->render == platform_render)
+#if (PROFILE == 1)
+// A PROFILE build charges the tests of entities against the platforms to their own slot
+void Profile_platformBegin(void);
+void Profile_platformEnd(void);
+#else // PROFILE
+#define Profile_platformBegin() ((void)0)
+#define Profile_platformEnd() ((void)0)
+#endif // PROFILE
+#else // MOVING_PLATFORMS
+#define isPlatform(e) false
+#endif // MOVING_PLATFORMS
+
+#if (PROJECTILES > 0)
+// Short-lived entities that are kept in a fixed pool, and only test the tile under their center against the level
+#define PROJECTILE_NONE 0xFF
+
+struct PROJECTILE;
+typedef struct PROJECTILE PROJECTILE;
+
+struct PROJECTILE {
+  int16_t x;
+  int16_t y;
+  int16_t dx;
+  int16_t dy;
+  uint8_t owner;  // tag of the player that threw it
+  uint8_t frames; // frames left before it falls apart on its own
+  uint8_t next;   // index of the next projectile in the live list or the free list
+} __attribute__ ((packed));
+
+extern PROJECTILE projectiles[PROJECTILES];
+extern uint8_t projectileLive; // index of the first projectile in flight, or PROJECTILE_NONE
+
+void projectile_reset(void);
+uint8_t projectile_spawn(const int16_t x, const int16_t y, const int16_t dx, const int16_t dy, const uint8_t owner);
+void projectile_despawn(const uint8_t i, const uint8_t prev);
+bool projectile_update(PROJECTILE* const p);
+void projectile_render(const uint8_t i);
+#endif // PROJECTILES
+
 void show_exit_sign(const uint8_t tx, const uint8_t ty);
 void hide_exit_sign(void);
 
@@ -15,6 +15,7 @@
  **************************************************************************/
 
 #include <stdint.h>
+#include <avr/io.h>
 #include "stackmon.h"
 
 /**************************************************************************
@@ -117,4 +118,34 @@ uint16_t StackCount(void)
     return c;
 }
 
+/** Count unused stack space since the last sample, and paint it again.
+ * Like StackCount(), but afterwards every byte below the current stack
+ * pointer is painted with the canary again, so that the next call only
+ * counts what was used in between.  Only the bytes that were found to
+ * have been used are painted, since the rest still hold the canary.
+ * Interrupts that run in between are counted too.
+ *
+ * Returns  The count of bytes that were not used since the last call.
+ */
+uint16_t StackSample(void)
+{
+    uint8_t       *p = &__bss_end;
+    uint8_t *const sp = (uint8_t *)SP;
+    uint16_t       c = 0;
+
+    while(*p == STACK_CANARY && p <= &__stack)
+    {
+        p++;
+        c++;
+    }
+
+    while(p < sp)
+    {
+        *p = STACK_CANARY;
+        p++;
+    }
+
+    return c;
+}
+
 /* END OF FILE */
@@ -37,8 +37,10 @@
 
 #if !defined(ON_PC)
 uint16_t StackCount(void);
+uint16_t StackSample(void);
 #else
 #define StackCount()    0
+#define StackSample()   0
 #endif
 
 #endif /* STACKMON_H */